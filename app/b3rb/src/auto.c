@@ -7,20 +7,21 @@
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
 
+#include <zros/private/zros_executor_struct.h>
 #include <zros/private/zros_node_struct.h>
 #include <zros/private/zros_pub_struct.h>
 #include <zros/private/zros_sub_struct.h>
+#include <zros/zros_executor.h>
 #include <zros/zros_node.h>
 #include <zros/zros_pub.h>
 #include <zros/zros_sub.h>
 
+#include <cerebri/core/workq.h>
+
 #include <synapse_topic_list.h>
 
 #include "mixing.h"
 
-#define MY_STACK_SIZE 1024
-#define MY_PRIORITY 4
-
 LOG_MODULE_REGISTER(b3rb_auto, CONFIG_CEREBRI_B3RB_LOG_LEVEL);
 
 typedef struct _context {
@@ -28,6 +29,7 @@ typedef struct _context {
 
     struct zros_sub sub_road_curve_angle;
     struct zros_pub pub_actuators;
+    struct zros_executor executor;
 
     synapse_msgs_RoadCurveAngle road_curve_angle;
     synapse_msgs_Actuators actuators;
@@ -51,64 +53,57 @@ static context g_ctx = {
     .max_velocity = CONFIG_CEREBRI_B3RB_MAX_VELOCITY_MM_S / 1000.0,
 };
 
-static void init(context* ctx)
-{
-    zros_node_init(&ctx->node, "b3rb_auto");
-    zros_sub_init(&ctx->sub_road_curve_angle, &ctx->node, &topic_road_curve_angle, &ctx->road_curve_angle, 10);
-    zros_pub_init(&ctx->pub_actuators, &ctx->node, &topic_actuators_auto, &ctx->actuators);
-}
-
 static double compute_velocity (context* ctx, double angle) {
     ARG_UNUSED(angle);
 
     return ctx->max_velocity / 2;
 }
 
-static void b3rb_auto_entry_point(void* p0, void* p1, void* p2)
+// runs on each road curve angle, and at 1 Hz regardless
+static void b3rb_auto_run(struct zros_executor* executor, uint32_t ready, void* user_data)
 {
-    LOG_INF("init");
-    context* ctx = p0;
-    ARG_UNUSED(p1);
-    ARG_UNUSED(p2);
-
-    init(ctx);
+    ARG_UNUSED(executor);
+    context* ctx = user_data;
 
-    struct k_poll_event events[] = {
-        *zros_sub_get_event(&ctx->sub_road_curve_angle),
-    };
-
-    while (true) {
-        k_poll(events, ARRAY_SIZE(events), K_MSEC(1000));
+    if (ready & BIT(0)) {
+        zros_sub_update(&ctx->sub_road_curve_angle);
+    }
 
-        if (zros_sub_update_available(&ctx->sub_road_curve_angle)) {
-            zros_sub_update(&ctx->sub_road_curve_angle);
-        }
+    /*
+        Compute actuator knowing road curve angle
+    */
 
-        /*
-            Compute actuator knowing road curve angle
-        */
+    double turn_angle = 0;
+    double road_curve_angle = ctx->road_curve_angle.angle;
 
-        double turn_angle = 0;
-        double road_curve_angle = ctx->road_curve_angle.angle;
+    if (road_curve_angle > ctx->max_turn_angle) {
+        turn_angle = ctx->max_turn_angle;
+    } else if (road_curve_angle < -ctx->max_turn_angle) {
+        turn_angle = -ctx->max_turn_angle;
+    } else {
+        turn_angle = road_curve_angle;
+    }
 
-        if (road_curve_angle > ctx->max_turn_angle) {
-            turn_angle = ctx->max_turn_angle;
-        } else if (road_curve_angle < -ctx->max_turn_angle) {
-            turn_angle = -ctx->max_turn_angle;
-        } else {
-            turn_angle = road_curve_angle;
-        }
+    double omega_fwd = compute_velocity (ctx, turn_angle);
 
-        double omega_fwd = compute_velocity (ctx, turn_angle);
+    b3rb_set_actuators(&ctx->actuators, turn_angle, omega_fwd);
 
-        b3rb_set_actuators(&ctx->actuators, turn_angle, omega_fwd);
+    zros_pub_update(&ctx->pub_actuators);
+}
 
-        zros_pub_update(&ctx->pub_actuators);
-    }
+static int b3rb_auto_init(void)
+{
+    LOG_INF("init");
+    context* ctx = &g_ctx;
+    zros_node_init(&ctx->node, "b3rb_auto");
+    zros_sub_init(&ctx->sub_road_curve_angle, &ctx->node, &topic_road_curve_angle, &ctx->road_curve_angle, 10);
+    zros_pub_init(&ctx->pub_actuators, &ctx->node, &topic_actuators_auto, &ctx->actuators);
+    zros_executor_init(&ctx->executor, "b3rb_auto", &g_high_priority_work_q, b3rb_auto_run, ctx);
+    zros_executor_add(&ctx->executor, &ctx->sub_road_curve_angle);
+    zros_executor_set_period(&ctx->executor, K_MSEC(1000));
+    return 0;
 }
 
-K_THREAD_DEFINE(b3rb_auto, MY_STACK_SIZE,
-    b3rb_auto_entry_point, (void*)&g_ctx, NULL, NULL,
-    MY_PRIORITY, 0, 1000);
+SYS_INIT(b3rb_auto_init, APPLICATION, 0);
 
 /* vi: ts=4 sw=4 et */
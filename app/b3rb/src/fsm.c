@@ -9,17 +9,20 @@
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
 
+#include <zros/private/zros_executor_struct.h>
 #include <zros/private/zros_node_struct.h>
 #include <zros/private/zros_pub_struct.h>
 #include <zros/private/zros_sub_struct.h>
+#include <zros/zros_executor.h>
 #include <zros/zros_node.h>
 #include <zros/zros_pub.h>
 #include <zros/zros_sub.h>
 
+#include <cerebri/core/clock.h>
+#include <cerebri/core/workq.h>
+
 #include <synapse_topic_list.h>
 
-#define MY_STACK_SIZE 3072
-#define MY_PRIORITY 4
 #define STATE_ANY -1
 
 LOG_MODULE_REGISTER(b3rb_fsm, CONFIG_CEREBRI_B3RB_LOG_LEVEL);
@@ -99,6 +102,8 @@ typedef struct _context {
     status_input_t status_input;
     struct zros_sub sub_joy;
     struct zros_pub pub_status;
+    struct zros_executor executor;
+    int64_t joy_last_ticks;
 } context;
 
 static context g_ctx = {
@@ -124,13 +129,6 @@ static context g_ctx = {
     .pub_status = {},
 };
 
-static void b3rb_fsm_init(context* ctx)
-{
-    zros_node_init(&ctx->node, "b3rb_fsm");
-    zros_sub_init(&ctx->sub_joy, &ctx->node, &topic_joy, &ctx->joy, 10);
-    zros_pub_init(&ctx->pub_status, &ctx->node, &topic_status, &ctx->status);
-}
-
 static void fsm_compute_input(status_input_t* input, const context* ctx)
 {
     input->request_arm = ctx->joy.buttons[JOY_BUTTON_ARM] == 1;
@@ -216,7 +214,7 @@ static void fsm_update(synapse_msgs_Status* status, const status_input_t* input)
         status->arming == synapse_msgs_Status_Arming_ARMING_ARMED, "disarm required");
 
     // set timestamp
-    stamp_header(&status->header, k_uptime_ticks());
+    stamp_header(&status->header, core_clock_ticks());
     status->header.seq++;
 }
 
@@ -231,60 +229,55 @@ static void status_add_extra_info(synapse_msgs_Status* status, status_input_t* i
     }
 }
 
-static void b3rb_fsm_entry_point(void* p0, void* p1, void* p2)
+// runs on joystick input, and at 1 Hz regardless
+static void b3rb_fsm_run(struct zros_executor* executor, uint32_t ready, void* user_data)
 {
-    LOG_INF("initializing b3rb_fsm");
-    context* ctx = p0;
-    ARG_UNUSED(p1);
-    ARG_UNUSED(p2);
-
-    b3rb_fsm_init(ctx);
+    ARG_UNUSED(executor);
+    context* ctx = user_data;
 
-    struct k_poll_event events[] = {
-        *zros_sub_get_event(&ctx->sub_joy),
-    };
-
-    int64_t joy_last_ticks = k_uptime_ticks();
+    // current ticks
+    int64_t now_ticks = core_clock_ticks();
     int64_t joy_loss_ticks = 1.0 * CONFIG_SYS_CLOCK_TICKS_PER_SEC;
 
-    while (true) {
-
-        // current ticks
-        int64_t now_ticks = k_uptime_ticks();
-
-        // wait for input event, publish at 1 Hz regardless
-        int rc = 0;
-        rc = k_poll(events, ARRAY_SIZE(events), K_MSEC(1000));
-        if (rc != 0) {
-            LOG_DBG("fsm joy/battery polling timeout");
+    if (ready & BIT(0)) {
+        zros_sub_update(&ctx->sub_joy);
+        if (ctx->status.joy == synapse_msgs_Status_Joy_JOY_LOSS) {
+            LOG_WRN("joy regained");
         }
+        ctx->joy_last_ticks = now_ticks;
+        ctx->status.joy = synapse_msgs_Status_Joy_JOY_NOMINAL;
+    } else {
+        LOG_DBG("fsm run without joy input");
+    }
 
-        if (zros_sub_update_available(&ctx->sub_joy)) {
-            zros_sub_update(&ctx->sub_joy);
-            if (ctx->status.joy == synapse_msgs_Status_Joy_JOY_LOSS) {
-                LOG_WRN("joy regained");
-            }
-            joy_last_ticks = now_ticks;
-            ctx->status.joy = synapse_msgs_Status_Joy_JOY_NOMINAL;
-        }
+    // check for joy loss
+    if (ctx->status.joy != synapse_msgs_Status_Joy_JOY_LOSS
+        && now_ticks - ctx->joy_last_ticks > joy_loss_ticks) {
+        LOG_WRN("joy loss");
+        ctx->status.joy = synapse_msgs_Status_Joy_JOY_LOSS;
+    }
 
-        // check for joy loss
-        if (ctx->status.joy != synapse_msgs_Status_Joy_JOY_LOSS
-            && now_ticks - joy_last_ticks > joy_loss_ticks) {
-            LOG_WRN("joy loss");
-            ctx->status.joy = synapse_msgs_Status_Joy_JOY_LOSS;
-        }
+    // perform processing
+    fsm_compute_input(&ctx->status_input, ctx);
+    fsm_update(&ctx->status, &ctx->status_input);
+    status_add_extra_info(&ctx->status, &ctx->status_input);
+    zros_pub_update(&ctx->pub_status);
+}
 
-        // perform processing
-        fsm_compute_input(&ctx->status_input, ctx);
-        fsm_update(&ctx->status, &ctx->status_input);
-        status_add_extra_info(&ctx->status, &ctx->status_input);
-        zros_pub_update(&ctx->pub_status);
-    }
+static int b3rb_fsm_init(void)
+{
+    LOG_INF("initializing b3rb_fsm");
+    context* ctx = &g_ctx;
+    zros_node_init(&ctx->node, "b3rb_fsm");
+    zros_sub_init(&ctx->sub_joy, &ctx->node, &topic_joy, &ctx->joy, 10);
+    zros_pub_init(&ctx->pub_status, &ctx->node, &topic_status, &ctx->status);
+    zros_executor_init(&ctx->executor, "b3rb_fsm", &g_high_priority_work_q, b3rb_fsm_run, ctx);
+    zros_executor_add(&ctx->executor, &ctx->sub_joy);
+    ctx->joy_last_ticks = core_clock_ticks();
+    zros_executor_set_period(&ctx->executor, K_MSEC(1000));
+    return 0;
 }
 
-K_THREAD_DEFINE(b3rb_fsm, MY_STACK_SIZE,
-    b3rb_fsm_entry_point, &g_ctx, NULL, NULL,
-    MY_PRIORITY, 0, 1000);
+SYS_INIT(b3rb_fsm_init, APPLICATION, 0);
 
 /* vi: ts=4 sw=4 et */
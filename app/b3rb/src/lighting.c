@@ -15,21 +15,16 @@
 #include <zros/zros_pub.h>
 #include <zros/zros_sub.h>
 
-#include <synapse_topic_list.h>
+#include <cerebri/core/clock.h>
+#include <cerebri/core/sched.h>
 
-#define MY_STACK_SIZE 2048
-#define MY_PRIORITY 4
+#include <synapse_topic_list.h>
 
 LOG_MODULE_REGISTER(b3rb_lighting, CONFIG_CEREBRI_B3RB_LOG_LEVEL);
 
-extern struct k_work_q g_low_priority_work_q;
-static void lighting_work_handler(struct k_work* work);
-static void lighting_timer_handler(struct k_timer* dummy);
-
 typedef struct context_ {
-    // work
-    struct k_work work_item;
-    struct k_timer timer;
+    // task
+    struct core_task task;
     // node
     struct zros_node node;
     // data
@@ -44,8 +39,6 @@ typedef struct context_ {
 } context_t;
 
 static context_t g_ctx = {
-    .work_item = Z_WORK_INITIALIZER(lighting_work_handler),
-    .timer = Z_TIMER_INITIALIZER(g_ctx.timer, lighting_timer_handler, NULL),
     .status = synapse_msgs_Status_init_default,
     .led_array = synapse_msgs_LEDArray_init_default,
     .sub_status = {},
@@ -55,14 +48,6 @@ static context_t g_ctx = {
     .lights_on = false,
 };
 
-static void lighting_init(context_t* ctx)
-{
-    zros_node_init(&ctx->node, "b3rb_lighting");
-    zros_sub_init(&ctx->sub_status, &ctx->node, &topic_status, &ctx->status, 10);
-    zros_sub_init(&ctx->sub_joy, &ctx->node, &topic_joy, &ctx->joy, 10);
-    zros_pub_init(&ctx->pub_led_array, &ctx->node, &topic_led_array, &ctx->led_array);
-}
-
 static void set_led(const int index, const double* color, const double brightness, synapse_msgs_LED* led)
 {
     led->index = index;
@@ -71,15 +56,15 @@ static void set_led(const int index, const double* color, const double brightnes
     led->b = brightness * color[2];
 }
 
-static void lighting_work_handler(struct k_work* work)
+static void lighting_run(struct core_task* task)
 {
-    context_t* ctx = CONTAINER_OF(work, context_t, work_item);
+    context_t* ctx = CONTAINER_OF(task, context_t, task);
 
     // update subscriptions
     zros_sub_update(&ctx->sub_status);
     zros_sub_update(&ctx->sub_joy);
 
-    double t = k_uptime_ticks() / ((double)CONFIG_SYS_CLOCK_TICKS_PER_SEC);
+    double t = core_clock_ticks() / ((double)CONFIG_SYS_CLOCK_TICKS_PER_SEC);
     const double led_pulse_freq = 0.25;
     const double brightness_min = 4;
     const double brightness_max = 30;
@@ -161,32 +146,27 @@ static void lighting_work_handler(struct k_work* work)
     }
 
     // set timestamp
-    stamp_header(&ctx->led_array.header, k_uptime_ticks());
+    stamp_header(&ctx->led_array.header, core_clock_ticks());
     ctx->led_array.header.seq++;
     ctx->led_array.led_count = led_msg_index;
 
     zros_pub_update(&ctx->pub_led_array);
 }
 
-static void lighting_timer_handler(struct k_timer* timer)
-{
-    context_t* ctx = CONTAINER_OF(timer, context_t, timer);
-    k_work_submit_to_queue(&g_low_priority_work_q, &ctx->work_item);
-}
-
-static void lighting_entry_point(void* p0, void* p1, void* p2)
+static int lighting_init(void)
 {
     LOG_INF("init");
-    context_t* ctx = p0;
-    ARG_UNUSED(p1);
-    ARG_UNUSED(p2);
-
-    lighting_init(ctx);
-    k_timer_start(&ctx->timer, K_MSEC(33), K_MSEC(33));
+    context_t* ctx = &g_ctx;
+    zros_node_init(&ctx->node, "b3rb_lighting");
+    zros_sub_init(&ctx->sub_status, &ctx->node, &topic_status, &ctx->status, 10);
+    zros_sub_init(&ctx->sub_joy, &ctx->node, &topic_joy, &ctx->joy, 10);
+    zros_pub_init(&ctx->pub_led_array, &ctx->node, &topic_led_array, &ctx->led_array);
+    // the phase keeps its releases off the 5 ms imu ones
+    core_task_init(&ctx->task, "b3rb_lighting", lighting_run, 33000, 2500, 500);
+    core_task_start(&ctx->task);
+    return 0;
 }
 
-K_THREAD_DEFINE(b3rb_lighting, MY_STACK_SIZE,
-    lighting_entry_point, &g_ctx, NULL, NULL,
-    MY_PRIORITY, 0, 1000);
+SYS_INIT(lighting_init, APPLICATION, 0);
 
 /* vi: ts=4 sw=4 et */
@@ -3,12 +3,14 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <cerebri/core/clock.h>
+
 #include "mixing.h"
 
 void b3rb_set_actuators(synapse_msgs_Actuators* msg, double turn_angle, double omega_fwd)
 {
     msg->has_header = true;
-    stamp_header(&msg->header, k_uptime_ticks());
+    stamp_header(&msg->header, core_clock_ticks());
     msg->header.seq++;
     strncpy(msg->header.frame_id, "odom", sizeof(msg->header.frame_id) - 1);
 
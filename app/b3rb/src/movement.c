@@ -8,22 +8,29 @@
 
 #include <zephyr/logging/log.h>
 
+#include <zros/private/zros_executor_struct.h>
 #include <zros/private/zros_node_struct.h>
 #include <zros/private/zros_pub_struct.h>
 #include <zros/private/zros_sub_struct.h>
+#include <zros/zros_executor.h>
 #include <zros/zros_node.h>
 #include <zros/zros_pub.h>
 #include <zros/zros_sub.h>
 
 #include <cerebri/core/casadi.h>
+#include <cerebri/core/workq.h>
 
 #include "mixing.h"
 
-#define MY_STACK_SIZE 3072
-#define MY_PRIORITY 4
-
 LOG_MODULE_REGISTER(b3rb_movement, CONFIG_CEREBRI_B3RB_LOG_LEVEL);
 
+// executor ready bits, in the order the subscriptions are added
+enum {
+    READY_STATUS = BIT(0),
+    READY_ACTUATORS_MANUAL = BIT(1),
+    READY_ACTUATORS_AUTO = BIT(2),
+};
+
 typedef struct _context {
     struct zros_node node;
 
@@ -35,6 +42,7 @@ typedef struct _context {
     synapse_msgs_Actuators actuators_auto;
 
     struct zros_pub pub_actuators;
+    struct zros_executor executor;
 
     const double wheel_radius;
     const double wheel_base;
@@ -58,9 +66,49 @@ static context g_ctx = {
     .wheel_base = CONFIG_CEREBRI_B3RB_WHEEL_BASE_MM / 1000.0,
 };
 
-static void init(context* ctx)
+static void stop(context* ctx)
+{
+    b3rb_set_actuators(&ctx->actuators, 0, 0);
+}
+
+// runs on each input, and at 1 Hz regardless
+static void b3rb_movement_run(struct zros_executor* executor, uint32_t ready, void* user_data)
 {
-    LOG_DBG("init movement");
+    ARG_UNUSED(executor);
+    context* ctx = user_data;
+
+    if (ready & READY_STATUS) {
+        zros_sub_update(&ctx->sub_status);
+    }
+
+    if (ready & READY_ACTUATORS_MANUAL) {
+        zros_sub_update(&ctx->sub_actuators_manual);
+    }
+
+    if (ready & READY_ACTUATORS_AUTO) {
+        zros_sub_update(&ctx->sub_actuators_auto);
+    }
+
+    if (ctx->status.arming != synapse_msgs_Status_Arming_ARMING_ARMED) {
+        stop(ctx);
+        LOG_DBG("not armed, stopped");
+    } else if (ctx->status.mode == synapse_msgs_Status_Mode_MODE_MANUAL) {
+        LOG_DBG("manual mode");
+        ctx->actuators = ctx->actuators_manual;
+    } else if(ctx->status.mode == synapse_msgs_Status_Mode_MODE_AUTO){
+        LOG_DBG("auto mode");
+        ctx->actuators = ctx->actuators_auto;
+    }
+
+    // publish
+
+    zros_pub_update(&ctx->pub_actuators);
+}
+
+static int b3rb_movement_init(void)
+{
+    LOG_INF("init");
+    context* ctx = &g_ctx;
 
     zros_node_init(&ctx->node, "b3rb_movement");
     zros_sub_init(&ctx->sub_status, &ctx->node, &topic_status, &ctx->status, 10);
@@ -72,62 +120,15 @@ static void init(context* ctx)
         &topic_actuators_auto, &ctx->actuators_auto, 10);
 
     zros_pub_init(&ctx->pub_actuators, &ctx->node, &topic_actuators, &ctx->actuators);
-}
 
-static void stop(context* ctx)
-{
-    b3rb_set_actuators(&ctx->actuators, 0, 0);
-}
-
-static void b3rb_movement_entry_point(void* p0, void* p1, void* p2)
-{
-    LOG_INF("init");
-    context* ctx = p0;
-    ARG_UNUSED(p1);
-    ARG_UNUSED(p2);
-
-    init(ctx);
-
-    struct k_poll_event events[] = {
-        *zros_sub_get_event(&ctx->sub_status),
-        *zros_sub_get_event(&ctx->sub_actuators_manual),
-        *zros_sub_get_event(&ctx->sub_actuators_auto),
-    };
-
-    while (true) {
-        k_poll(events, ARRAY_SIZE(events), K_MSEC(1000));
-
-        if (zros_sub_update_available(&ctx->sub_status)) {
-            zros_sub_update(&ctx->sub_status);
-        }
-
-        if (zros_sub_update_available(&ctx->sub_actuators_manual)) {
-            zros_sub_update(&ctx->sub_actuators_manual);
-        }
-
-        if (zros_sub_update_available(&ctx->sub_actuators_auto)) {
-            zros_sub_update(&ctx->sub_actuators_auto);
-        }
-
-        if (ctx->status.arming != synapse_msgs_Status_Arming_ARMING_ARMED) {
-            stop(ctx);
-            LOG_DBG("not armed, stopped");
-        } else if (ctx->status.mode == synapse_msgs_Status_Mode_MODE_MANUAL) {
-            LOG_DBG("manual mode");
-            ctx->actuators = ctx->actuators_manual;
-        } else if(ctx->status.mode == synapse_msgs_Status_Mode_MODE_AUTO){
-            LOG_DBG("auto mode");
-            ctx->actuators = ctx->actuators_auto;
-        }
-
-        // publish
-
-        zros_pub_update(&ctx->pub_actuators);
-    }
+    zros_executor_init(&ctx->executor, "b3rb_movement", &g_high_priority_work_q, b3rb_movement_run, ctx);
+    zros_executor_add(&ctx->executor, &ctx->sub_status);
+    zros_executor_add(&ctx->executor, &ctx->sub_actuators_manual);
+    zros_executor_add(&ctx->executor, &ctx->sub_actuators_auto);
+    zros_executor_set_period(&ctx->executor, K_MSEC(1000));
+    return 0;
 }
 
-K_THREAD_DEFINE(b3rb_movement, MY_STACK_SIZE,
-    b3rb_movement_entry_point, &g_ctx, NULL, NULL,
-    MY_PRIORITY, 0, 1000);
+SYS_INIT(b3rb_movement_init, APPLICATION, 0);
 
 /* vi: ts=4 sw=4 et */
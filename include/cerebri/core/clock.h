@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2024 CogniPilot Foundation
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef CEREBRI_CORE_CLOCK_H
+#define CEREBRI_CORE_CLOCK_H
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/slist.h>
+
+// The clock counts kernel ticks from an epoch. It follows the kernel uptime,
+// or, with CONFIG_CEREBRI_CORE_CLOCK_STEPPED, only moves when a simulator
+// calls core_clock_step(). Nodes use it for stamps, timeouts and timers so
+// they run the same either way.
+
+struct core_clock_timer;
+struct core_clock_listener;
+
+typedef void (*core_clock_timer_expiry_t)(struct core_clock_timer* timer);
+typedef void (*core_clock_reset_t)(struct core_clock_listener* listener);
+
+// periodic timer on the clock, the expiry runs in interrupt context, or in
+// the thread stepping the clock, so keep it to submitting work
+struct core_clock_timer {
+    struct k_timer _timer;
+    core_clock_timer_expiry_t _expiry;
+    int64_t _period; // ticks, 0 for a timer that expires once
+    int64_t _next; // uptime ticks of the next expiry, stepped clock only
+    sys_snode_t _node;
+};
+
+// told of every epoch reset, in the thread calling core_clock_reset, so
+// timers started at times since the old epoch can be started again
+struct core_clock_listener {
+    core_clock_reset_t _reset;
+    sys_snode_t _node;
+};
+
+#define CORE_CLOCK_TIMER_INITIALIZER(OBJ, EXPIRY) \
+    {                                             \
+        ._timer = Z_TIMER_INITIALIZER(OBJ._timer, \
+            _core_clock_timer_expiry, NULL),      \
+        ._expiry = EXPIRY,                        \
+    }
+
+// ticks since the clock epoch, use for message stamps and elapsed time
+int64_t core_clock_ticks(void);
+
+// uptime in ticks of the clock epoch, 0 unless reset
+int64_t core_clock_epoch(void);
+
+// restart the clock at the current uptime, a replay calls this before
+// its first message so stamps do not depend on when it was started
+void core_clock_reset(void);
+
+// call reset after every core_clock_reset, adding a listener twice is fine
+void core_clock_listen(struct core_clock_listener* listener, core_clock_reset_t reset);
+
+// timeout at the next multiple of period since the epoch, for periodic
+// wakeups that land on the same clock times in every run, kernel uptime
+// clock only, K_FOREVER and K_NO_WAIT are passed through
+k_timeout_t core_clock_next(k_timeout_t period);
+
+// runtime alternative to CORE_CLOCK_TIMER_INITIALIZER
+void core_clock_timer_init(struct core_clock_timer* timer, core_clock_timer_expiry_t expiry);
+// like k_timer_start with period as duration and period, K_FOREVER stops
+// the timer and K_NO_WAIT expires it once
+void core_clock_timer_start(struct core_clock_timer* timer, k_timeout_t period);
+// first expiry at clock ticks since the epoch, then every period, or only
+// once for a K_NO_WAIT or K_FOREVER period
+void core_clock_timer_start_at(struct core_clock_timer* timer, int64_t first, k_timeout_t period);
+void core_clock_timer_stop(struct core_clock_timer* timer);
+
+#ifdef CONFIG_CEREBRI_CORE_CLOCK_STEPPED
+// advance the clock, firing the timers due on the way in time order
+void core_clock_step(int64_t ticks);
+#endif
+
+// private, the k_timer expiry of a core_clock_timer
+void _core_clock_timer_expiry(struct k_timer* timer);
+
+#endif // CEREBRI_CORE_CLOCK_H
+// vi: ts=4 sw=4 et
@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2024 CogniPilot Foundation
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef CEREBRI_CORE_SCHED_H
+#define CEREBRI_CORE_SCHED_H
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/slist.h>
+
+#include <cerebri/core/clock.h>
+#include <cerebri/core/workq.h>
+
+// Periodic tasks, released on the core clock at phase + n * period since
+// the epoch and run on a shared work queue chosen by period, rate
+// monotonic: short periods on the high priority queue. The deadline is
+// the next release. Phases let tasks with related periods release apart
+// instead of all at once. Started tasks are aligned again on an epoch
+// reset.
+
+struct core_task;
+
+typedef void (*core_task_handler_t)(struct core_task* task);
+
+struct core_task {
+    struct core_work _work;
+    struct core_clock_timer _timer;
+    core_task_handler_t _handler;
+    uint32_t _period_us;
+    uint32_t _phase_us;
+    uint32_t _budget_us; // expected worst case execution time, 0 if unknown
+    uint32_t _budget_overruns; // runs that took longer than the budget
+    bool _started;
+    sys_snode_t _node;
+};
+
+void core_task_init(struct core_task* task, const char* name, core_task_handler_t handler,
+    uint32_t period_us, uint32_t phase_us, uint32_t budget_us);
+
+// release from the next phase + n * period on
+void core_task_start(struct core_task* task);
+void core_task_stop(struct core_task* task);
+
+#endif // CEREBRI_CORE_SCHED_H
+// vi: ts=4 sw=4 et
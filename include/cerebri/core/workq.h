@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2024 CogniPilot Foundation
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef CEREBRI_CORE_WORKQ_H
+#define CEREBRI_CORE_WORKQ_H
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/slist.h>
+
+// Shared work queues, see lib/core/workqueues/Kconfig for priorities and
+// stack sizes. High priority is for the control loop and never yields,
+// low priority for housekeeping, background for jobs that take long or
+// block, such as calibration or file system writes, so they do not hold
+// up the other two.
+extern struct k_work_q g_high_priority_work_q;
+extern struct k_work_q g_low_priority_work_q;
+extern struct k_work_q g_background_work_q;
+
+struct core_work;
+
+typedef void (*core_work_handler_t)(struct core_work* work);
+
+// run time statistics, times in microseconds
+struct core_work_stats {
+    uint32_t runs;
+    uint32_t overruns; // runs finished later than the deadline after submit
+    uint32_t skipped; // submits merged into a run still queued
+    uint32_t latency_max; // submit to start
+    uint32_t exec_max; // start to finish
+    uint64_t latency_sum;
+    uint64_t exec_sum;
+};
+
+// a k_work bound to a queue, with a deadline and statistics
+struct core_work {
+    struct k_work _work;
+    struct k_work_q* _queue;
+    core_work_handler_t _handler;
+    const char* _name;
+    uint32_t _deadline_us; // 0 for none
+    uint32_t _submit_cycles; // cycle count of the submit being served
+    struct core_work_stats _stats;
+    sys_snode_t _node;
+};
+
+void core_work_init(struct core_work* work, const char* name, struct k_work_q* queue,
+    core_work_handler_t handler, uint32_t deadline_us);
+
+// submit to the bound queue, safe from interrupts, returns as
+// k_work_submit_to_queue
+int core_work_submit(struct core_work* work);
+
+// change the deadline, 0 for none, counted from the next run on
+void core_work_set_deadline(struct core_work* work, uint32_t deadline_us);
+
+// consistent copy of the statistics, and clearing them
+void core_work_stats_get(const struct core_work* work, struct core_work_stats* stats);
+void core_work_stats_reset(struct core_work* work);
+
+#endif // CEREBRI_CORE_WORKQ_H
+// vi: ts=4 sw=4 et
@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2024 CogniPilot Foundation
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef CEREBRI_SYNAPSE_LOG_FORMAT_H
+#define CEREBRI_SYNAPSE_LOG_FORMAT_H
+
+#include <stdint.h>
+
+/********************************************************************
+ * synapse log format, shared by syn_log, syn_replay and synapse_tool
+ *
+ * magic | record | record | ...
+ *
+ * a record is a little endian header of a uint64 time in ns, uint16
+ * tinyframe type and uint16 payload length, then the payload, a nanopb
+ * encoded message like the payload of a tinyframe of that type.
+ ********************************************************************/
+
+#define SYNAPSE_LOG_MAGIC "SYNLOG1" // with its nul, 8 bytes
+#define SYNAPSE_LOG_MAGIC_SIZE 8
+#define SYNAPSE_LOG_RECORD_HEADER_SIZE 12
+
+struct synapse_log_record_header {
+    uint64_t t_ns;
+    uint16_t type;
+    uint16_t len;
+};
+
+static inline void synapse_log_put_record_header(uint8_t* buf, uint64_t t_ns, uint16_t type,
+    uint16_t len)
+{
+    for (int i = 0; i < 8; i++) {
+        buf[i] = (uint8_t)(t_ns >> (8 * i));
+    }
+    buf[8] = (uint8_t)type;
+    buf[9] = (uint8_t)(type >> 8);
+    buf[10] = (uint8_t)len;
+    buf[11] = (uint8_t)(len >> 8);
+}
+
+static inline void synapse_log_get_record_header(const uint8_t* buf,
+    struct synapse_log_record_header* hdr)
+{
+    hdr->t_ns = 0;
+    for (int i = 0; i < 8; i++) {
+        hdr->t_ns |= (uint64_t)buf[i] << (8 * i);
+    }
+    hdr->type = (uint16_t)(buf[8] | (buf[9] << 8));
+    hdr->len = (uint16_t)(buf[10] | (buf[11] << 8));
+}
+
+#endif // CEREBRI_SYNAPSE_LOG_FORMAT_H
+// vi: ts=4 sw=4 et
@@ -10,11 +10,15 @@
 #include <zephyr/logging/log.h>
 #include <zephyr/shell/shell.h>
 
+#include <zros/private/zros_executor_struct.h>
 #include <zros/private/zros_node_struct.h>
 #include <zros/private/zros_sub_struct.h>
+#include <zros/zros_executor.h>
 #include <zros/zros_node.h>
 #include <zros/zros_sub.h>
 
+#include <cerebri/core/workq.h>
+
 #include <synapse_protobuf/led_array.pb.h>
 #include <synapse_topic_list.h>
 
@@ -22,14 +26,10 @@
 
 LOG_MODULE_REGISTER(actuate_led_array, CONFIG_CEREBRI_ACTUATE_LED_ARRAY_LOG_LEVEL);
 
-extern struct k_work_q g_low_priority_work_q;
-
-#define MY_STACK_SIZE 4096
-#define MY_PRIORITY 4
-
 typedef struct _context {
     struct zros_node node;
     struct zros_sub sub;
+    struct zros_executor executor;
     synapse_msgs_LEDArray data;
     const struct device* strip;
     struct led_rgb strip_colors[CONFIG_CEREBRI_ACTUATE_LED_ARRAY_COUNT];
@@ -43,59 +43,53 @@ static context g_ctx = {
     .strip_colors = {},
 };
 
-static void actuate_led_array_init(context* ctx)
+// runs on each led array message, and at 1 Hz regardless
+static void actuate_led_array_run(struct zros_executor* executor, uint32_t ready, void* user_data)
 {
-    zros_node_init(&ctx->node, "actuate_led_array");
-    zros_sub_init(&ctx->sub, &ctx->node, &topic_led_array, &ctx->data, 10);
-    g_ctx.strip = DEVICE_DT_GET_ANY(apa_apa102);
-    if (!g_ctx.strip) {
-        LOG_ERR("LED strip device not found");
-        return;
-    } else if (!device_is_ready(g_ctx.strip)) {
-        LOG_ERR("LED strip device %s is not ready", g_ctx.strip->name);
-        return;
-    } else {
-        LOG_INF("Found LED strip device %s", g_ctx.strip->name);
+    ARG_UNUSED(executor);
+    ARG_UNUSED(ready);
+    context* ctx = user_data;
+
+    // perform processing, reading the latest message in place
+    const synapse_msgs_LEDArray* data = NULL;
+    if (zros_sub_borrow(&ctx->sub, (const void**)&data) == 0) {
+        for (int i = 0; i < data->led_count; i++) {
+            const synapse_msgs_LED* led = &data->led[i];
+            if (led->index > CONFIG_CEREBRI_ACTUATE_LED_ARRAY_COUNT) {
+                LOG_ERR("Setting LED index out of range");
+                continue;
+            }
+            ctx->strip_colors[led->index].r = led->r;
+            ctx->strip_colors[led->index].g = led->g;
+            ctx->strip_colors[led->index].b = led->b;
+        }
+        zros_sub_release(&ctx->sub);
     }
+    led_strip_update_rgb(ctx->strip, ctx->strip_colors, CONFIG_CEREBRI_ACTUATE_LED_ARRAY_COUNT);
 }
 
-void actuate_led_array_entry_point(context* ctx)
+static int actuate_led_array_init(void)
 {
     LOG_INF("init");
-    actuate_led_array_init(ctx);
-
-    struct k_poll_event events[2] = {
-        *zros_sub_get_event(&ctx->sub),
-    };
-
-    while (true) {
-        int rc = 0;
-        rc = k_poll(events, ARRAY_SIZE(events), K_MSEC(1000));
-        if (rc != 0) {
-            LOG_DBG("sub polling error! %d", rc);
-        }
-
-        if (zros_sub_update_available(&ctx->sub)) {
-            zros_sub_update(&ctx->sub);
-        }
-
-        // perform processing
-        for (int i = 0; i < ctx->data.led_count; i++) {
-            synapse_msgs_LED led = ctx->data.led[i];
-            if (led.index > CONFIG_CEREBRI_ACTUATE_LED_ARRAY_COUNT) {
-                LOG_ERR("Setting LED index out of range");
-                continue;
-            }
-            ctx->strip_colors[led.index].r = led.r;
-            ctx->strip_colors[led.index].g = led.g;
-            ctx->strip_colors[led.index].b = led.b;
-        }
-        led_strip_update_rgb(ctx->strip, ctx->strip_colors, CONFIG_CEREBRI_ACTUATE_LED_ARRAY_COUNT);
+    context* ctx = &g_ctx;
+    ctx->strip = DEVICE_DT_GET_ANY(apa_apa102);
+    if (!ctx->strip) {
+        LOG_ERR("LED strip device not found");
+        return -ENODEV;
+    } else if (!device_is_ready(ctx->strip)) {
+        LOG_ERR("LED strip device %s is not ready", ctx->strip->name);
+        return -ENODEV;
+    } else {
+        LOG_INF("Found LED strip device %s", ctx->strip->name);
     }
+    zros_node_init(&ctx->node, "actuate_led_array");
+    zros_sub_init(&ctx->sub, &ctx->node, &topic_led_array, &ctx->data, 10);
+    zros_executor_init(&ctx->executor, "actuate_led_array", &g_low_priority_work_q, actuate_led_array_run, ctx);
+    zros_executor_add(&ctx->executor, &ctx->sub);
+    zros_executor_set_period(&ctx->executor, K_MSEC(1000));
+    return 0;
 }
 
-K_THREAD_DEFINE(actuate_led_array, MY_STACK_SIZE,
-    actuate_led_array_entry_point, &g_ctx, NULL, NULL,
-    MY_PRIORITY, 0, 100);
+SYS_INIT(actuate_led_array_init, APPLICATION, 0);
 
 /* vi: ts=4 sw=4 et */
@@ -7,6 +7,7 @@ menuconfig CEREBRI_ACTUATE_PWM
   bool "PWM"
   depends on PWM
   depends on CEREBRI_SYNAPSE_ZROS
+  depends on CEREBRI_CORE_WORKQUEUES
   help
     This option enables pwm actuators
 
@@ -10,18 +10,19 @@
 #include <zephyr/logging/log.h>
 #include <zephyr/shell/shell.h>
 
+#include <zros/private/zros_executor_struct.h>
 #include <zros/private/zros_node_struct.h>
 #include <zros/private/zros_sub_struct.h>
+#include <zros/zros_executor.h>
 #include <zros/zros_node.h>
 #include <zros/zros_sub.h>
 
+#include <cerebri/core/workq.h>
+
 #include <synapse_topic_list.h>
 
 LOG_MODULE_REGISTER(actuate_pwm, CONFIG_CEREBRI_ACTUATE_PWM_LOG_LEVEL);
 
-#define MY_STACK_SIZE 4096
-#define MY_PRIORITY 4
-
 #define PWM_SHELL_NODE DT_NODE_EXISTS(DT_NODELABEL(pwm_shell))
 
 extern actuator_pwm_t g_actuator_pwms[];
@@ -31,6 +32,7 @@ typedef struct _context {
     synapse_msgs_Status status;
     struct zros_node node;
     struct zros_sub sub_actuators, sub_status;
+    struct zros_executor executor;
     struct pwm_dt_spec pwm_enable;
 } context;
 
@@ -43,13 +45,6 @@ static context g_ctx = {
     .pwm_enable = PWM_DT_SPEC_GET(DT_CHILD(DT_NODELABEL(pwm_shell), aux2)),
 };
 
-static void actuate_pwm_init(context* ctx)
-{
-    zros_node_init(&ctx->node, "actuate_pwm");
-    zros_sub_init(&ctx->sub_actuators, &ctx->node, &topic_actuators, &ctx->actuators, 100);
-    zros_sub_init(&ctx->sub_status, &ctx->node, &topic_status, &ctx->status, 100);
-}
-
 void pwm_update(const synapse_msgs_Status* status, const synapse_msgs_Actuators* actuators)
 {
     bool armed = status->arming == synapse_msgs_Status_Arming_ARMING_ARMED;
@@ -121,41 +116,39 @@ void pwm_update(const synapse_msgs_Status* status, const synapse_msgs_Actuators*
     }
 }
 
-void actuate_pwm_entry_point(void* p0, void* p1, void* p2)
+// runs on each actuators message, status is only read, at 1 Hz regardless
+static void actuate_pwm_run(struct zros_executor* executor, uint32_t ready, void* user_data)
 {
-    LOG_INF("init");
-    context* ctx = p0;
-    ARG_UNUSED(p1);
-    ARG_UNUSED(p2);
+    ARG_UNUSED(executor);
+    context* ctx = user_data;
 
-    actuate_pwm_init(ctx);
-
-    struct k_poll_event events[] = {
-        *zros_sub_get_event(&ctx->sub_actuators),
-    };
-
-    while (true) {
-        int rc = 0;
-        rc = k_poll(events, ARRAY_SIZE(events), K_MSEC(1000));
-        if (rc != 0) {
-            LOG_DBG("no actuator message received");
-        }
+    if (zros_sub_update_available(&ctx->sub_status)) {
+        zros_sub_update(&ctx->sub_status);
+    }
 
-        if (zros_sub_update_available(&ctx->sub_status)) {
-            zros_sub_update(&ctx->sub_status);
-        }
+    if (ready & BIT(0)) {
+        zros_sub_update(&ctx->sub_actuators);
+    } else {
+        LOG_DBG("no actuator message received");
+    }
 
-        if (zros_sub_update_available(&ctx->sub_actuators)) {
-            zros_sub_update(&ctx->sub_actuators);
-        }
+    // update pwm
+    pwm_update(&ctx->status, &ctx->actuators);
+}
 
-        // update pwm
-        pwm_update(&ctx->status, &ctx->actuators);
-    }
+static int actuate_pwm_init(void)
+{
+    LOG_INF("init");
+    context* ctx = &g_ctx;
+    zros_node_init(&ctx->node, "actuate_pwm");
+    zros_sub_init(&ctx->sub_actuators, &ctx->node, &topic_actuators, &ctx->actuators, 100);
+    zros_sub_init(&ctx->sub_status, &ctx->node, &topic_status, &ctx->status, 100);
+    zros_executor_init(&ctx->executor, "actuate_pwm", &g_high_priority_work_q, actuate_pwm_run, ctx);
+    zros_executor_add(&ctx->executor, &ctx->sub_actuators);
+    zros_executor_set_period(&ctx->executor, K_MSEC(1000));
+    return 0;
 }
 
-K_THREAD_DEFINE(actuate_pwm, MY_STACK_SIZE,
-    actuate_pwm_entry_point, &g_ctx, NULL, NULL,
-    MY_PRIORITY, 0, 100);
+SYS_INIT(actuate_pwm_init, APPLICATION, 0);
 
 /* vi: ts=4 sw=4 et */
@@ -10,8 +10,10 @@
 
 #include <zros/private/zros_node_struct.h>
 #include <zros/private/zros_sub_struct.h>
+#include <zros/private/zros_waitset_struct.h>
 #include <zros/zros_node.h>
 #include <zros/zros_sub.h>
+#include <zros/zros_waitset.h>
 
 #include <synapse_topic_list.h>
 
@@ -28,6 +30,7 @@ typedef struct _context {
     synapse_msgs_Status_Safety status_last_safety;
     uint32_t status_last_request_seq;
     struct zros_sub sub_status;
+    struct zros_waitset waitset;
     struct tones_t* sound;
     int sound_size;
     const struct pwm_dt_spec buzzer;
@@ -53,6 +56,8 @@ static void init_actuate_sound(context* ctx)
     LOG_DBG("init actuate sound");
     zros_node_init(&ctx->node, "actuate_sound");
     zros_sub_init(&ctx->sub_status, &ctx->node, &topic_status, &ctx->status, 1);
+    zros_waitset_init(&ctx->waitset, NULL);
+    zros_waitset_add(&ctx->waitset, &ctx->sub_status);
     if (!pwm_is_ready_dt(&ctx->buzzer)) {
         LOG_ERR("Sound device %s is not ready!", ctx->buzzer.dev->name);
     }
@@ -81,10 +86,6 @@ static void actuate_sound_entry_point(void* p0, void* p1, void* p2)
 
     init_actuate_sound(ctx);
 
-    struct k_poll_event events[] = {
-        *zros_sub_get_event(&ctx->sub_status),
-    };
-
     int64_t joy_loss_last_alarm_ticks = 0;
     int64_t fuel_low_last_alarm_ticks = 0;
     float joy_loss_period_sec = 3.0;
@@ -92,16 +93,14 @@ static void actuate_sound_entry_point(void* p0, void* p1, void* p2)
 
     while (true) {
 
-        int rc = 0;
-        rc = k_poll(events, ARRAY_SIZE(events), K_MSEC(1000));
+        uint32_t ready = 0;
+        int rc = zros_waitset_wait(&ctx->waitset, K_MSEC(1000), &ready);
         if (rc != 0) {
             LOG_DBG("Sound poll failed");
             continue;
         }
 
-        if (zros_sub_update_available(&ctx->sub_status)) {
-            zros_sub_update(&ctx->sub_status);
-        }
+        zros_sub_update(&ctx->sub_status);
 
         if (ctx->status.mode != ctx->status_last_mode) {
             ctx->status_last_mode = ctx->status.mode;
@@ -0,0 +1,265 @@
+/*
+ * Copyright (c) 2024 CogniPilot Foundation
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdlib.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/shell/shell.h>
+
+#include <cerebri/core/clock.h>
+
+LOG_MODULE_REGISTER(core_clock, CONFIG_CEREBRI_CORE_CLOCK_LOG_LEVEL);
+
+// 64 bit, so not atomic on every target
+static struct k_spinlock g_lock;
+static int64_t g_epoch;
+static sys_slist_t g_listeners = SYS_SLIST_STATIC_INIT(&g_listeners);
+
+#ifdef CONFIG_CEREBRI_CORE_CLOCK_STEPPED
+static int64_t g_uptime;
+static sys_slist_t g_timers = SYS_SLIST_STATIC_INIT(&g_timers);
+
+// caller holds g_lock
+static int64_t uptime(void)
+{
+    return g_uptime;
+}
+
+// period of a timer, 0 for one that expires once, like k_timer_start
+// with a K_NO_WAIT or K_FOREVER period
+static int64_t timer_period(k_timeout_t period)
+{
+    return K_TIMEOUT_EQ(period, K_FOREVER) ? 0 : MAX(period.ticks, 0);
+}
+#else
+static int64_t uptime(void)
+{
+    return k_uptime_ticks();
+}
+#endif
+
+int64_t core_clock_epoch(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&g_lock);
+    int64_t epoch = g_epoch;
+    k_spin_unlock(&g_lock, key);
+    return epoch;
+}
+
+int64_t core_clock_ticks(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&g_lock);
+    int64_t ticks = uptime() - g_epoch;
+    k_spin_unlock(&g_lock, key);
+    return ticks;
+}
+
+void core_clock_reset(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&g_lock);
+    g_epoch = uptime();
+    k_spin_unlock(&g_lock, key);
+    LOG_INF("epoch reset");
+
+    // listeners are only ever appended, so the walk needs no lock
+    struct core_clock_listener* listener;
+    SYS_SLIST_FOR_EACH_CONTAINER(&g_listeners, listener, _node)
+    {
+        listener->_reset(listener);
+    }
+}
+
+void core_clock_listen(struct core_clock_listener* listener, core_clock_reset_t reset)
+{
+    k_spinlock_key_t key = k_spin_lock(&g_lock);
+    if (!sys_slist_find(&g_listeners, &listener->_node, NULL)) {
+        listener->_reset = reset;
+        sys_slist_append(&g_listeners, &listener->_node);
+    }
+    k_spin_unlock(&g_lock, key);
+}
+
+k_timeout_t core_clock_next(k_timeout_t period)
+{
+#ifdef CONFIG_CEREBRI_CORE_CLOCK_STEPPED
+    // kernel timeouts do not follow a stepped clock
+    ARG_UNUSED(period);
+    return K_FOREVER;
+#else
+    // no period never comes round, a zero one is due now
+    if (K_TIMEOUT_EQ(period, K_FOREVER) || K_TIMEOUT_EQ(period, K_NO_WAIT)) {
+        return period;
+    }
+    k_spinlock_key_t key = k_spin_lock(&g_lock);
+    int64_t now = uptime();
+    int64_t ticks = MAX(period.ticks, 1);
+    int64_t next = g_epoch + ((now - g_epoch) / ticks + 1) * ticks;
+    k_spin_unlock(&g_lock, key);
+#ifdef CONFIG_TIMEOUT_64BIT
+    return K_TIMEOUT_ABS_TICKS(next);
+#else
+    return K_TICKS(next - k_uptime_ticks());
+#endif
+#endif
+}
+
+void core_clock_timer_init(struct core_clock_timer* timer, core_clock_timer_expiry_t expiry)
+{
+    k_timer_init(&timer->_timer, _core_clock_timer_expiry, NULL);
+    timer->_expiry = expiry;
+    timer->_period = 0;
+    timer->_next = 0;
+    timer->_node.next = NULL;
+}
+
+#ifdef CONFIG_CEREBRI_CORE_CLOCK_STEPPED
+// caller holds g_lock
+static void timer_add(struct core_clock_timer* timer, int64_t next, k_timeout_t period)
+{
+    timer->_period = timer_period(period);
+    timer->_next = next;
+    if (!sys_slist_find(&g_timers, &timer->_node, NULL)) {
+        sys_slist_append(&g_timers, &timer->_node);
+    }
+}
+
+void core_clock_timer_start(struct core_clock_timer* timer, k_timeout_t period)
+{
+    k_spinlock_key_t key = k_spin_lock(&g_lock);
+    if (K_TIMEOUT_EQ(period, K_FOREVER)) {
+        sys_slist_find_and_remove(&g_timers, &timer->_node);
+    } else {
+        timer_add(timer, g_uptime + timer_period(period), period);
+    }
+    k_spin_unlock(&g_lock, key);
+}
+
+void core_clock_timer_start_at(struct core_clock_timer* timer, int64_t first, k_timeout_t period)
+{
+    k_spinlock_key_t key = k_spin_lock(&g_lock);
+    timer_add(timer, g_epoch + first, period);
+    k_spin_unlock(&g_lock, key);
+}
+
+void core_clock_timer_stop(struct core_clock_timer* timer)
+{
+    k_spinlock_key_t key = k_spin_lock(&g_lock);
+    sys_slist_find_and_remove(&g_timers, &timer->_node);
+    k_spin_unlock(&g_lock, key);
+}
+
+void core_clock_step(int64_t ticks)
+{
+    k_spinlock_key_t key = k_spin_lock(&g_lock);
+    int64_t target = g_uptime + ticks;
+    while (true) {
+        // earliest timer due by the target
+        int64_t due = INT64_MAX;
+        struct core_clock_timer* timer = NULL;
+        struct core_clock_timer* t;
+        SYS_SLIST_FOR_EACH_CONTAINER(&g_timers, t, _node)
+        {
+            if (t->_next <= target && t->_next < due) {
+                due = t->_next;
+                timer = t;
+            }
+        }
+        if (timer == NULL) {
+            break;
+        }
+
+        g_uptime = MAX(g_uptime, due);
+        if (timer->_period > 0) {
+            timer->_next += timer->_period;
+        } else {
+            sys_slist_find_and_remove(&g_timers, &timer->_node);
+        }
+        k_spin_unlock(&g_lock, key);
+        timer->_expiry(timer);
+        key = k_spin_lock(&g_lock);
+    }
+    g_uptime = target;
+    k_spin_unlock(&g_lock, key);
+}
+#else
+void core_clock_timer_start(struct core_clock_timer* timer, k_timeout_t period)
+{
+    timer->_period = period.ticks;
+    // k_timer_start ignores a K_FOREVER duration, leaving the timer running
+    if (K_TIMEOUT_EQ(period, K_FOREVER)) {
+        k_timer_stop(&timer->_timer);
+    } else {
+        k_timer_start(&timer->_timer, period, period);
+    }
+}
+
+void core_clock_timer_start_at(struct core_clock_timer* timer, int64_t first, k_timeout_t period)
+{
+    timer->_period = period.ticks;
+    int64_t next = core_clock_epoch() + first;
+#ifdef CONFIG_TIMEOUT_64BIT
+    k_timer_start(&timer->_timer, K_TIMEOUT_ABS_TICKS(next), period);
+#else
+    k_timer_start(&timer->_timer, K_TICKS(MAX(next - k_uptime_ticks(), 0)), period);
+#endif
+}
+
+void core_clock_timer_stop(struct core_clock_timer* timer)
+{
+    k_timer_stop(&timer->_timer);
+}
+#endif
+
+void _core_clock_timer_expiry(struct k_timer* timer)
+{
+    struct core_clock_timer* clock_timer = CONTAINER_OF(timer, struct core_clock_timer, _timer);
+    clock_timer->_expiry(clock_timer);
+}
+
+#ifdef CONFIG_SHELL
+static int cmd_status(const struct shell* sh,
+    size_t argc, char** argv, void* data)
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+    ARG_UNUSED(data);
+
+    shell_print(sh, "stepped: %d", IS_ENABLED(CONFIG_CEREBRI_CORE_CLOCK_STEPPED));
+    shell_print(sh, "ticks: %lld", (long long)core_clock_ticks());
+    shell_print(sh, "epoch: %lld", (long long)core_clock_epoch());
+    return 0;
+}
+
+#ifdef CONFIG_CEREBRI_CORE_CLOCK_STEPPED
+// one tick at a time, yielding so woken nodes run before the next tick
+static int cmd_step(const struct shell* sh,
+    size_t argc, char** argv, void* data)
+{
+    ARG_UNUSED(data);
+
+    if (argc != 2) {
+        shell_print(sh, "usage: clock step <ms>");
+        return -EINVAL;
+    }
+    int64_t ticks = k_ms_to_ticks_ceil64(strtoll(argv[1], NULL, 10));
+    for (int64_t i = 0; i < ticks; i++) {
+        core_clock_step(1);
+        k_yield();
+    }
+    return 0;
+}
+#endif
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_clock,
+    SHELL_CMD(status, NULL, "status", cmd_status),
+#ifdef CONFIG_CEREBRI_CORE_CLOCK_STEPPED
+    SHELL_CMD(step, NULL, "step <ms>", cmd_step),
+#endif
+    SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(clock, &sub_clock, "core clock commands", NULL);
+#endif
+
+// vi: ts=4 sw=4 et
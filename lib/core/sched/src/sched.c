@@ -0,0 +1,260 @@
+/*
+ * Copyright (c) 2024 CogniPilot Foundation
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <math.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/shell/shell.h>
+
+#include <cerebri/core/sched.h>
+
+LOG_MODULE_REGISTER(core_sched, CONFIG_CEREBRI_CORE_SCHED_LOG_LEVEL);
+
+// guards the task list, budget counters and started flags
+static struct k_spinlock g_lock;
+static sys_slist_t g_tasks = SYS_SLIST_STATIC_INIT(&g_tasks);
+// uptime ticks of the last statistics reset, exec times are measured in
+// cpu cycles, so this is real time even on a stepped clock, and an epoch
+// reset does not move it
+static int64_t g_stats_start;
+static struct core_clock_listener g_clock_listener;
+
+// rate monotonic, the shorter the period the higher the priority
+static struct k_work_q* task_queue(uint32_t period_us)
+{
+    return period_us <= CONFIG_CEREBRI_CORE_SCHED_HIGH_PRIORITY_PERIOD_US
+        ? &g_high_priority_work_q
+        : &g_low_priority_work_q;
+}
+
+static const char* queue_name(const struct k_work_q* queue)
+{
+    return queue == &g_high_priority_work_q ? "high_priority_q" : "low_priority_q";
+}
+
+// Liu and Layland bound on the utilization n rate monotonic tasks are
+// sure to meet their deadlines with, only a guide here, as work items on a
+// queue do not preempt each other
+static double rm_bound(int n)
+{
+    return n * (pow(2.0, 1.0 / n) - 1);
+}
+
+// declared utilization of the tasks on a queue, in budget per period
+static double queue_utilization(const struct k_work_q* queue, int* n)
+{
+    double utilization = 0;
+    *n = 0;
+    struct core_task* task;
+    SYS_SLIST_FOR_EACH_CONTAINER(&g_tasks, task, _node)
+    {
+        if (task->_work._queue == queue) {
+            utilization += (double)task->_budget_us / task->_period_us;
+            (*n)++;
+        }
+    }
+    return utilization;
+}
+
+static void task_run(struct core_work* work)
+{
+    struct core_task* task = CONTAINER_OF(work, struct core_task, _work);
+    uint32_t start = k_cycle_get_32();
+    task->_handler(task);
+    uint32_t exec = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+    if (task->_budget_us > 0 && exec > task->_budget_us) {
+        k_spinlock_key_t key = k_spin_lock(&g_lock);
+        task->_budget_overruns++;
+        k_spin_unlock(&g_lock, key);
+    }
+}
+
+static void task_release(struct core_clock_timer* timer)
+{
+    struct core_task* task = CONTAINER_OF(timer, struct core_task, _timer);
+    core_work_submit(&task->_work);
+}
+
+// next release at phase + n * period since the epoch, caller holds g_lock
+static void task_align(struct core_task* task)
+{
+    int64_t period = MAX(k_us_to_ticks_ceil64(task->_period_us), 1);
+    int64_t phase = k_us_to_ticks_ceil64(task->_phase_us) % period;
+    int64_t now = core_clock_ticks();
+    int64_t first = now < phase ? phase : phase + ((now - phase) / period + 1) * period;
+    core_clock_timer_start_at(&task->_timer, first, K_TICKS(period));
+}
+
+// releases were at times since the old epoch
+static void clock_reset(struct core_clock_listener* listener)
+{
+    ARG_UNUSED(listener);
+    k_spinlock_key_t key = k_spin_lock(&g_lock);
+    struct core_task* task;
+    SYS_SLIST_FOR_EACH_CONTAINER(&g_tasks, task, _node)
+    {
+        if (task->_started) {
+            task_align(task);
+        }
+    }
+    k_spin_unlock(&g_lock, key);
+}
+
+// the deadline of a release is the next one, a run still queued at the
+// next release counts as skipped, one finishing after it as an overrun
+void core_task_init(struct core_task* task, const char* name, core_task_handler_t handler,
+    uint32_t period_us, uint32_t phase_us, uint32_t budget_us)
+{
+    __ASSERT(period_us > 0, "core task period is zero");
+    core_work_init(&task->_work, name, task_queue(period_us), task_run, period_us);
+    core_clock_timer_init(&task->_timer, task_release);
+    task->_handler = handler;
+    task->_period_us = period_us;
+    task->_phase_us = phase_us % period_us;
+    task->_budget_us = budget_us;
+    task->_budget_overruns = 0;
+    task->_started = false;
+    core_clock_listen(&g_clock_listener, clock_reset);
+
+    k_spinlock_key_t key = k_spin_lock(&g_lock);
+    if (!sys_slist_find(&g_tasks, &task->_node, NULL)) {
+        sys_slist_append(&g_tasks, &task->_node);
+    }
+    int n = 0;
+    double utilization = queue_utilization(task->_work._queue, &n);
+    k_spin_unlock(&g_lock, key);
+
+    if (utilization > rm_bound(n)) {
+        LOG_WRN("%s: %d task budgets use %d%% of %s, above the rate monotonic bound %d%%",
+            name, n, (int)(100 * utilization), queue_name(task->_work._queue),
+            (int)(100 * rm_bound(n)));
+    }
+}
+
+void core_task_start(struct core_task* task)
+{
+    k_spinlock_key_t key = k_spin_lock(&g_lock);
+    task->_started = true;
+    task_align(task);
+    k_spin_unlock(&g_lock, key);
+}
+
+void core_task_stop(struct core_task* task)
+{
+    k_spinlock_key_t key = k_spin_lock(&g_lock);
+    task->_started = false;
+    core_clock_timer_stop(&task->_timer);
+    k_spin_unlock(&g_lock, key);
+}
+
+#ifdef CONFIG_SHELL
+// tenths of a percent
+static uint32_t permille(uint64_t part, uint64_t whole)
+{
+    return whole > 0 ? (uint32_t)(1000 * part / whole) : 0;
+}
+
+#define STATUS_TASKS_MAX 16
+
+// a task, copied under g_lock and printed after
+struct task_sample {
+    const char* name;
+    const struct k_work_q* queue;
+    uint32_t period_us;
+    uint32_t phase_us;
+    uint32_t budget_us;
+    uint32_t budget_overruns;
+    struct core_work_stats stats;
+};
+
+static int cmd_status(const struct shell* sh,
+    size_t argc, char** argv, void* data)
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+    ARG_UNUSED(data);
+
+    static struct task_sample samples[STATUS_TASKS_MAX];
+    int n = 0;
+    k_spinlock_key_t key = k_spin_lock(&g_lock);
+    int64_t start = g_stats_start;
+    struct core_task* task;
+    SYS_SLIST_FOR_EACH_CONTAINER(&g_tasks, task, _node)
+    {
+        if (n == STATUS_TASKS_MAX) {
+            break;
+        }
+        struct task_sample* sample = &samples[n++];
+        sample->name = task->_work._name;
+        sample->queue = task->_work._queue;
+        sample->period_us = task->_period_us;
+        sample->phase_us = task->_phase_us;
+        sample->budget_us = task->_budget_us;
+        sample->budget_overruns = task->_budget_overruns;
+        core_work_stats_get(&task->_work, &sample->stats);
+    }
+    k_spin_unlock(&g_lock, key);
+
+    uint64_t elapsed_us = k_ticks_to_us_floor64(k_uptime_ticks() - start);
+    shell_print(sh, "statistics over %llu ms", (unsigned long long)(elapsed_us / 1000));
+
+    for (int i = 0; i < n; i++) {
+        const struct task_sample* sample = &samples[i];
+        const struct core_work_stats* stats = &sample->stats;
+        uint32_t runs = MAX(stats->runs, 1);
+        uint32_t cpu = permille(stats->exec_sum, elapsed_us);
+        shell_print(sh, "%s: period %u us, phase %u us, budget %u us, on %s",
+            sample->name, sample->period_us, sample->phase_us, sample->budget_us,
+            queue_name(sample->queue));
+        shell_print(sh, "  runs %u, deadline misses %u, budget overruns %u",
+            stats->runs, stats->overruns + stats->skipped, sample->budget_overruns);
+        shell_print(sh, "  jitter mean %u max %u us, exec mean %u max %u us, cpu %u.%u%%",
+            (uint32_t)(stats->latency_sum / runs), stats->latency_max,
+            (uint32_t)(stats->exec_sum / runs), stats->exec_max, cpu / 10, cpu % 10);
+    }
+
+    struct k_work_q* queues[] = { &g_high_priority_work_q, &g_low_priority_work_q };
+    for (size_t i = 0; i < ARRAY_SIZE(queues); i++) {
+        int tasks = 0;
+        key = k_spin_lock(&g_lock);
+        double utilization = queue_utilization(queues[i], &tasks);
+        k_spin_unlock(&g_lock, key);
+        if (tasks > 0) {
+            shell_print(sh, "%s: %d tasks, budgets %d%%, rate monotonic bound %d%%",
+                queue_name(queues[i]), tasks, (int)(100 * utilization), (int)(100 * rm_bound(tasks)));
+        }
+    }
+    return 0;
+}
+
+static int cmd_reset(const struct shell* sh,
+    size_t argc, char** argv, void* data)
+{
+    ARG_UNUSED(sh);
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+    ARG_UNUSED(data);
+
+    k_spinlock_key_t key = k_spin_lock(&g_lock);
+    struct core_task* task;
+    SYS_SLIST_FOR_EACH_CONTAINER(&g_tasks, task, _node)
+    {
+        core_work_stats_reset(&task->_work);
+        task->_budget_overruns = 0;
+    }
+    g_stats_start = k_uptime_ticks();
+    k_spin_unlock(&g_lock, key);
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_sched,
+    SHELL_CMD(status, NULL, "status", cmd_status),
+    SHELL_CMD(reset, NULL, "reset statistics", cmd_reset),
+    SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(sched, &sub_sched, "periodic task scheduler commands", NULL);
+#endif
+
+// vi: ts=4 sw=4 et
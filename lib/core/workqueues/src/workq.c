@@ -2,57 +2,264 @@
  * Copyright CogniPilot Foundation 2023
  * SPDX-License-Identifier: Apache-2.0
  */
+#include <string.h>
+
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/shell/shell.h>
+
+#include <cerebri/core/workq.h>
 
 LOG_MODULE_REGISTER(core_workqueues, CONFIG_CEREBRI_CORE_WORKQUEUES_LOG_LEVEL);
 
-#define THREAD_STACK_SIZE 2048
-#define THREAD_PRIORITY 6
+K_THREAD_STACK_DEFINE(high_priority_stack_area, CONFIG_CEREBRI_CORE_WORKQUEUES_HIGH_PRIORITY_STACK_SIZE);
+K_THREAD_STACK_DEFINE(low_priority_stack_area, CONFIG_CEREBRI_CORE_WORKQUEUES_LOW_PRIORITY_STACK_SIZE);
+K_THREAD_STACK_DEFINE(background_stack_area, CONFIG_CEREBRI_CORE_WORKQUEUES_BACKGROUND_STACK_SIZE);
 
-#define LOW_PRIORITY_STACK_SIZE 8192
-#define LOW_PRIORITY_PRIORITY 0
+struct k_work_q g_high_priority_work_q, g_low_priority_work_q, g_background_work_q;
 
-#define HIGH_PRIORITY_STACK_SIZE 8192
-#define HIGH_PRIORITY_PRIORITY -1
+struct queue_info {
+    struct k_work_q* queue;
+    const char* name;
+    k_thread_stack_t* stack;
+    size_t stack_size;
+    int priority;
+    bool no_yield;
+    struct core_work_stats stats; // of the core_work items run on it
+};
 
-K_THREAD_STACK_DEFINE(high_priority_stack_area, HIGH_PRIORITY_STACK_SIZE);
-K_THREAD_STACK_DEFINE(low_priority_stack_area, LOW_PRIORITY_STACK_SIZE);
+static struct queue_info g_queues[] = {
+    {
+        .queue = &g_high_priority_work_q,
+        .name = "high_priority_q",
+        .stack = high_priority_stack_area,
+        .stack_size = K_THREAD_STACK_SIZEOF(high_priority_stack_area),
+        .priority = CONFIG_CEREBRI_CORE_WORKQUEUES_HIGH_PRIORITY_PRIORITY,
+        .no_yield = true,
+    },
+    {
+        .queue = &g_low_priority_work_q,
+        .name = "low_priority_q",
+        .stack = low_priority_stack_area,
+        .stack_size = K_THREAD_STACK_SIZEOF(low_priority_stack_area),
+        .priority = CONFIG_CEREBRI_CORE_WORKQUEUES_LOW_PRIORITY_PRIORITY,
+        .no_yield = false,
+    },
+    {
+        .queue = &g_background_work_q,
+        .name = "background_q",
+        .stack = background_stack_area,
+        .stack_size = K_THREAD_STACK_SIZEOF(background_stack_area),
+        .priority = CONFIG_CEREBRI_CORE_WORKQUEUES_BACKGROUND_PRIORITY,
+        .no_yield = false,
+    },
+};
 
-struct k_work_q g_high_priority_work_q, g_low_priority_work_q;
+// guards the statistics and the submit stamps
+static struct k_spinlock g_lock;
+static sys_slist_t g_works = SYS_SLIST_STATIC_INIT(&g_works);
 
-int core_workqueues_entry_point(void)
+static struct queue_info* find_queue(const struct k_work_q* queue)
 {
-    // high priority
-    k_work_queue_init(&g_high_priority_work_q);
-    struct k_work_queue_config high_priority_cfg = {
-        .name = "high_priority_q",
-        .no_yield = true
-    };
-    k_work_queue_start(
-        &g_high_priority_work_q,
-        high_priority_stack_area,
-        K_THREAD_STACK_SIZEOF(high_priority_stack_area),
-        HIGH_PRIORITY_PRIORITY,
-        &high_priority_cfg);
-
-    // high priority
-    k_work_queue_init(&g_low_priority_work_q);
-    struct k_work_queue_config low_priority_cfg = {
-        .name = "low_priority_q",
-        .no_yield = false
-    };
-    k_work_queue_start(
-        &g_low_priority_work_q,
-        low_priority_stack_area,
-        K_THREAD_STACK_SIZEOF(low_priority_stack_area),
-        LOW_PRIORITY_PRIORITY,
-        &low_priority_cfg);
+    for (size_t i = 0; i < ARRAY_SIZE(g_queues); i++) {
+        if (g_queues[i].queue == queue) {
+            return &g_queues[i];
+        }
+    }
+    return NULL;
+}
+
+static void stats_add(struct core_work_stats* stats, uint32_t latency, uint32_t exec, bool overrun)
+{
+    stats->runs++;
+    stats->overruns += overrun;
+    stats->latency_max = MAX(stats->latency_max, latency);
+    stats->exec_max = MAX(stats->exec_max, exec);
+    stats->latency_sum += latency;
+    stats->exec_sum += exec;
+}
+
+static void core_work_handler(struct k_work* item)
+{
+    struct core_work* work = CONTAINER_OF(item, struct core_work, _work);
+
+    k_spinlock_key_t key = k_spin_lock(&g_lock);
+    uint32_t submitted = work->_submit_cycles;
+    k_spin_unlock(&g_lock, key);
+
+    uint32_t start = k_cycle_get_32();
+    work->_handler(work);
+    uint32_t end = k_cycle_get_32();
+
+    uint32_t latency = k_cyc_to_us_floor32(start - submitted);
+    uint32_t exec = k_cyc_to_us_floor32(end - start);
+    bool overrun = work->_deadline_us > 0 && latency + exec > work->_deadline_us;
+    if (overrun) {
+        LOG_DBG("%s overrun: %u us latency, %u us exec", work->_name, latency, exec);
+    }
+
+    struct queue_info* info = find_queue(work->_queue);
+    key = k_spin_lock(&g_lock);
+    stats_add(&work->_stats, latency, exec, overrun);
+    if (info != NULL) {
+        stats_add(&info->stats, latency, exec, overrun);
+    }
+    k_spin_unlock(&g_lock, key);
+}
+
+void core_work_init(struct core_work* work, const char* name, struct k_work_q* queue,
+    core_work_handler_t handler, uint32_t deadline_us)
+{
+    k_work_init(&work->_work, core_work_handler);
+    work->_queue = queue;
+    work->_handler = handler;
+    work->_name = name;
+    work->_deadline_us = deadline_us;
+    work->_submit_cycles = 0;
+    memset(&work->_stats, 0, sizeof(work->_stats));
+
+    k_spinlock_key_t key = k_spin_lock(&g_lock);
+    if (!sys_slist_find(&g_works, &work->_node, NULL)) {
+        sys_slist_append(&g_works, &work->_node);
+    }
+    k_spin_unlock(&g_lock, key);
+}
+
+int core_work_submit(struct core_work* work)
+{
+    // stamp a new run only, a work still queued keeps the first submit
+    uint32_t now = k_cycle_get_32();
+    k_spinlock_key_t key = k_spin_lock(&g_lock);
+    if (!(k_work_busy_get(&work->_work) & K_WORK_QUEUED)) {
+        work->_submit_cycles = now;
+    }
+    k_spin_unlock(&g_lock, key);
+
+    int rc = k_work_submit_to_queue(work->_queue, &work->_work);
+    if (rc == 0) {
+        struct queue_info* info = find_queue(work->_queue);
+        key = k_spin_lock(&g_lock);
+        work->_stats.skipped++;
+        if (info != NULL) {
+            info->stats.skipped++;
+        }
+        k_spin_unlock(&g_lock, key);
+    }
+    return rc;
+}
+
+void core_work_set_deadline(struct core_work* work, uint32_t deadline_us)
+{
+    k_spinlock_key_t key = k_spin_lock(&g_lock);
+    work->_deadline_us = deadline_us;
+    k_spin_unlock(&g_lock, key);
+}
+
+void core_work_stats_get(const struct core_work* work, struct core_work_stats* stats)
+{
+    k_spinlock_key_t key = k_spin_lock(&g_lock);
+    *stats = work->_stats;
+    k_spin_unlock(&g_lock, key);
+}
+
+void core_work_stats_reset(struct core_work* work)
+{
+    k_spinlock_key_t key = k_spin_lock(&g_lock);
+    memset(&work->_stats, 0, sizeof(work->_stats));
+    k_spin_unlock(&g_lock, key);
+}
+
+// started before the application, so nodes can submit from their init
+static int core_workqueues_init(void)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(g_queues); i++) {
+        struct queue_info* info = &g_queues[i];
+        struct k_work_queue_config cfg = {
+            .name = info->name,
+            .no_yield = info->no_yield,
+        };
+        k_work_queue_init(info->queue);
+        k_work_queue_start(info->queue, info->stack, info->stack_size, info->priority, &cfg);
+    }
+    return 0;
+}
+
+SYS_INIT(core_workqueues_init, POST_KERNEL, 0);
+
+#ifdef CONFIG_SHELL
+static void print_stats(const struct shell* sh, const struct core_work_stats* stats)
+{
+    uint32_t runs = MAX(stats->runs, 1);
+    shell_print(sh, "  runs %u overruns %u skipped %u", stats->runs, stats->overruns, stats->skipped);
+    shell_print(sh, "  latency mean %u max %u us, exec mean %u max %u us",
+        (uint32_t)(stats->latency_sum / runs), stats->latency_max,
+        (uint32_t)(stats->exec_sum / runs), stats->exec_max);
+}
+
+static int cmd_status(const struct shell* sh,
+    size_t argc, char** argv, void* data)
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+    ARG_UNUSED(data);
+
+    for (size_t i = 0; i < ARRAY_SIZE(g_queues); i++) {
+        struct queue_info* info = &g_queues[i];
+        k_spinlock_key_t key = k_spin_lock(&g_lock);
+        struct core_work_stats stats = info->stats;
+        k_spin_unlock(&g_lock, key);
+#ifdef CONFIG_THREAD_STACK_INFO
+        size_t unused = 0;
+        k_thread_stack_space_get(k_work_queue_thread_get(info->queue), &unused);
+        shell_print(sh, "%s: priority %d, stack %u, unused %u", info->name, info->priority,
+            (unsigned)info->stack_size, (unsigned)unused);
+#else
+        shell_print(sh, "%s: priority %d, stack %u", info->name, info->priority,
+            (unsigned)info->stack_size);
+#endif
+        print_stats(sh, &stats);
+    }
+
+    struct core_work* work;
+    SYS_SLIST_FOR_EACH_CONTAINER(&g_works, work, _node)
+    {
+        struct queue_info* info = find_queue(work->_queue);
+        struct core_work_stats stats;
+        core_work_stats_get(work, &stats);
+        shell_print(sh, "%s: on %s, deadline %u us", work->_name,
+            info != NULL ? info->name : "?", work->_deadline_us);
+        print_stats(sh, &stats);
+    }
     return 0;
 }
 
-K_THREAD_DEFINE(core_workqueues, THREAD_STACK_SIZE,
-    core_workqueues_entry_point, NULL, NULL, NULL,
-    THREAD_PRIORITY, 0, 0);
+static int cmd_reset(const struct shell* sh,
+    size_t argc, char** argv, void* data)
+{
+    ARG_UNUSED(sh);
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+    ARG_UNUSED(data);
+
+    k_spinlock_key_t key = k_spin_lock(&g_lock);
+    for (size_t i = 0; i < ARRAY_SIZE(g_queues); i++) {
+        memset(&g_queues[i].stats, 0, sizeof(g_queues[i].stats));
+    }
+    struct core_work* work;
+    SYS_SLIST_FOR_EACH_CONTAINER(&g_works, work, _node)
+    {
+        memset(&work->_stats, 0, sizeof(work->_stats));
+    }
+    k_spin_unlock(&g_lock, key);
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_workq,
+    SHELL_CMD(status, NULL, "status", cmd_status),
+    SHELL_CMD(reset, NULL, "reset statistics", cmd_reset),
+    SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(workq, &sub_workq, "work queue commands", NULL);
+#endif
 
 // vi: ts=4 sw=4 et
@@ -8,7 +8,10 @@
 #include <zephyr/drivers/sensor.h>
 #include <zephyr/logging/log.h>
 
+#include <cerebri/core/clock.h>
 #include <cerebri/core/common.h>
+#include <cerebri/core/sched.h>
+#include <cerebri/core/workq.h>
 
 #include <synapse_topic_list.h>
 
@@ -27,14 +30,13 @@ LOG_MODULE_REGISTER(sense_imu, CONFIG_CEREBRI_SENSE_IMU_LOG_LEVEL);
 static const double g_accel = 9.8;
 static const int g_calibration_count = 100;
 
-extern struct k_work_q g_high_priority_work_q;
-void imu_work_handler(struct k_work* work);
-void imu_timer_handler(struct k_timer* dummy);
+void imu_run(struct core_task* task);
+void imu_calibrate_work_handler(struct core_work* work);
 
 typedef struct context_t {
     // work
-    struct k_work work_item;
-    struct k_timer timer;
+    struct core_task task;
+    struct core_work calibrate_work;
     // node
     struct zros_node node;
     // data
@@ -42,6 +44,7 @@ typedef struct context_t {
     synapse_msgs_Status status;
     synapse_msgs_Status_Mode last_mode;
     bool calibrated;
+    atomic_t calibrating; // the background calibration owns the sensors
     // publications
     struct zros_pub pub_imu;
     // subscriptions
@@ -59,8 +62,6 @@ typedef struct context_t {
 } context_t;
 
 static context_t g_ctx = {
-    .work_item = Z_WORK_INITIALIZER(imu_work_handler),
-    .timer = Z_TIMER_INITIALIZER(g_ctx.timer, imu_timer_handler, NULL),
     .node = {},
     .imu = {
         .has_header = true,
@@ -93,6 +94,9 @@ static void imu_init(context_t* ctx)
     zros_node_init(&ctx->node, "sense_imu");
     zros_pub_init(&ctx->pub_imu, &ctx->node, &topic_imu, &ctx->imu);
     zros_sub_init(&ctx->sub_status, &ctx->node, &topic_status, &ctx->status, 1);
+    core_task_init(&ctx->task, "sense_imu", imu_run, 5000, 0, 1000);
+    core_work_init(&ctx->calibrate_work, "sense_imu_calibrate", &g_background_work_q,
+        imu_calibrate_work_handler, 0);
 
     // setup accel devices
 
@@ -289,7 +293,7 @@ void imu_publish(context_t* ctx)
     static const int gyro_select = 0;
 
     // update message
-    stamp_header(&ctx->imu.header, k_uptime_ticks());
+    stamp_header(&ctx->imu.header, core_clock_ticks());
     ctx->imu.header.seq++;
     ctx->imu.angular_velocity.x = ctx->gyro_raw[gyro_select][0] - ctx->gyro_bias[gyro_select][0];
     ctx->imu.angular_velocity.y = ctx->gyro_raw[gyro_select][1] - ctx->gyro_bias[gyro_select][1];
@@ -303,9 +307,21 @@ void imu_publish(context_t* ctx)
     // LOG_INF("publish imu");
 }
 
-void imu_work_handler(struct k_work* work)
+// runs on the background queue, it sleeps between samples
+void imu_calibrate_work_handler(struct core_work* work)
 {
-    context_t* ctx = CONTAINER_OF(work, context_t, work_item);
+    context_t* ctx = CONTAINER_OF(work, context_t, calibrate_work);
+    imu_calibrate(ctx);
+    atomic_set(&ctx->calibrating, 0);
+}
+
+void imu_run(struct core_task* task)
+{
+    context_t* ctx = CONTAINER_OF(task, context_t, task);
+
+    if (atomic_get(&ctx->calibrating)) {
+        return;
+    }
 
     // update status
     if (zros_sub_update_available(&ctx->sub_status)) {
@@ -320,7 +336,8 @@ void imu_work_handler(struct k_work* work)
 
     if (!ctx->calibrated) {
         LOG_INF("calibrating");
-        imu_calibrate(ctx);
+        atomic_set(&ctx->calibrating, 1);
+        core_work_submit(&ctx->calibrate_work);
         return;
     }
 
@@ -328,19 +345,13 @@ void imu_work_handler(struct k_work* work)
     imu_publish(ctx);
 }
 
-void imu_timer_handler(struct k_timer* timer)
-{
-    context_t* ctx = CONTAINER_OF(timer, context_t, timer);
-    k_work_submit_to_queue(&g_high_priority_work_q, &ctx->work_item);
-}
-
 int sense_imu_entry_point(context_t* ctx)
 {
     LOG_INF("init");
     imu_init(ctx);
     // delay initiali calibration 1 s
     k_msleep(1000);
-    k_timer_start(&ctx->timer, K_MSEC(5), K_MSEC(5));
+    core_task_start(&ctx->task);
     return 0;
 }
 
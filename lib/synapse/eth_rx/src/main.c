@@ -2,9 +2,10 @@
 #include <zephyr/shell/shell.h>
 
 #include <zros/private/zros_node_struct.h>
-#include <zros/private/zros_sub_struct.h>
+#include <zros/private/zros_pub_struct.h>
+#include <zros/private/zros_topic_struct.h>
 #include <zros/zros_node.h>
-#include <zros/zros_sub.h>
+#include <zros/zros_pub.h>
 
 #include "proto/udp_rx.h"
 #include <synapse_topic_list.h>
@@ -20,6 +21,14 @@
 
 LOG_MODULE_REGISTER(syn_eth_rx, LOG_LEVEL_INF);
 
+// topics accepted from the host, all in loan mode
+static struct zros_topic* const g_rx_topics[] = {
+    &topic_joy,
+    &topic_road_curve_angle,
+};
+
+#define RX_TOPIC_COUNT ARRAY_SIZE(g_rx_topics)
+
 static K_THREAD_STACK_DEFINE(g_my_stack_area, MY_STACK_SIZE);
 static struct k_thread g_my_thread_data;
 
@@ -27,34 +36,67 @@ struct context {
     struct zros_node node;
     struct udp_rx udp;
     TinyFrame tf;
+    struct k_timer tf_tick;
     atomic_t running;
+    // publications, one per accepted topic
+    struct zros_pub pubs[RX_TOPIC_COUNT];
+    // frame counters, accepted = decoded + rejected + dropped
+    uint32_t accepted; // complete frames from tinyframe
+    uint32_t decoded; // published
+    uint32_t rejected; // unknown type, too large or not decodable
+    uint32_t dropped; // no free topic buffer
 };
 
 static struct context g_ctx;
 
-#define TOPIC_LISTENER(CHANNEL, CLASS)                                            \
-    static TF_Result CHANNEL##_listener(TinyFrame* tf, TF_Msg* frame)             \
-    {                                                                             \
-        CLASS msg = CLASS##_init_default;                                         \
-        pb_istream_t stream = pb_istream_from_buffer(frame->data, frame->len);    \
-        int rc = pb_decode(&stream, CLASS##_fields, &msg);                        \
-        if (rc) {                                                                 \
-            zros_topic_publish(&topic_##CHANNEL, &msg);                           \
-            LOG_DBG("%s decoding\n", #CHANNEL);                                   \
-        } else {                                                                  \
-            LOG_WRN("%s decoding failed: %s\n", #CHANNEL, PB_GET_ERROR(&stream)); \
-        }                                                                         \
-        return TF_STAY;                                                           \
+// index of the topic in g_rx_topics, -1 if it is not accepted
+static int rx_index(const struct zros_topic* topic)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(g_rx_topics); i++) {
+        if (g_rx_topics[i] == topic) {
+            return i;
+        }
     }
+    return -1;
+}
 
-// topic listeners
-TOPIC_LISTENER(joy, synapse_msgs_Joy)
-TOPIC_LISTENER(road_curve_angle, synapse_msgs_RoadCurveAngle)
-
-static TF_Result genericListener(TinyFrame* tf, TF_Msg* msg)
+// resolve the topic from the frame type through the registry and decode
+// with its nanopb descriptor straight into a loaned topic buffer
+static TF_Result genericListener(TinyFrame* tf, TF_Msg* frame)
 {
-    LOG_WRN("unhandled tinyframe type: %4d", msg->type);
-    // dumpFrameInfo(msg);
+    struct context* ctx = tf->userdata;
+    ctx->accepted++;
+    struct zros_topic* topic = synapse_topic_from_tf_type(frame->type);
+    int i = topic == NULL ? -1 : rx_index(topic);
+    if (i < 0) {
+        LOG_WRN("unhandled tinyframe type: %4d", frame->type);
+        ctx->rejected++;
+        return TF_STAY;
+    }
+
+    // a valid encoding is never longer than the message allows
+    if (frame->len > topic->_encoded_size) {
+        LOG_WRN("%s frame too large: %d", topic->_name, (int)frame->len);
+        ctx->rejected++;
+        return TF_STAY;
+    }
+
+    void* msg = NULL;
+    if (zros_pub_loan(&ctx->pubs[i], &msg) < 0) {
+        ctx->dropped++;
+        return TF_STAY;
+    }
+    memset(msg, 0, topic->_size);
+    pb_istream_t stream = pb_istream_from_buffer(frame->data, frame->len);
+    if (pb_decode(&stream, topic->_fields, msg)) {
+        zros_pub_commit(&ctx->pubs[i]);
+        ctx->decoded++;
+        LOG_DBG("%s decoding\n", topic->_name);
+    } else {
+        zros_pub_cancel(&ctx->pubs[i]);
+        ctx->rejected++;
+        LOG_WRN("%s decoding failed: %s\n", topic->_name, PB_GET_ERROR(&stream));
+    }
     return TF_STAY;
 }
 
@@ -78,19 +120,33 @@ static int init(struct context* ctx)
         return ret;
     }
     ctx->tf.userdata = ctx;
+    k_timer_init(&ctx->tf_tick, NULL, NULL);
+
+    // setup publications
+    ctx->accepted = 0;
+    ctx->decoded = 0;
+    ctx->rejected = 0;
+    ctx->dropped = 0;
+    for (size_t i = 0; i < RX_TOPIC_COUNT; i++) {
+        struct zros_topic* topic = g_rx_topics[i];
+        if (topic->_fields == NULL || topic->_mode != ZROS_TOPIC_MODE_LOAN) {
+            LOG_ERR("topic %s can not be decoded in place", topic->_name);
+            return -EINVAL;
+        }
+        ret = zros_pub_init(&ctx->pubs[i], &ctx->node, topic, topic->_data);
+        if (ret < 0) {
+            LOG_ERR("pub init %s failed: %d", topic->_name, ret);
+            return ret;
+        }
+    }
 
     // add tinyframe listeners
     ret = TF_AddGenericListener(&ctx->tf, genericListener);
     if (ret < 0)
         return ret;
 
-    ret = TF_AddTypeListener(&ctx->tf, SYNAPSE_JOY_TOPIC, joy_listener);
-    if (ret < 0)
-        return ret;
-
-    ret = TF_AddTypeListener(&ctx->tf, SYNAPSE_ROAD_CURVE_ANGLE_TOPIC, road_curve_angle_listener);
-    if (ret < 0)
-        return ret;
+    k_timer_start(&ctx->tf_tick, K_MSEC(CONFIG_CEREBRI_SYNAPSE_ETH_RX_TF_TICK_MS),
+        K_MSEC(CONFIG_CEREBRI_SYNAPSE_ETH_RX_TF_TICK_MS));
 
     ctx->running = ATOMIC_INIT(1);
     return ret;
@@ -99,6 +155,13 @@ static int init(struct context* ctx)
 static int fini(struct context* ctx)
 {
     int ret = 0;
+    k_timer_stop(&ctx->tf_tick);
+
+    // close publications
+    for (size_t i = 0; i < RX_TOPIC_COUNT; i++) {
+        zros_pub_fini(&ctx->pubs[i]);
+    }
+
     // close udp socket
     ret = udp_rx_fini(&ctx->udp);
 
@@ -126,16 +189,30 @@ static void run(void* p0, void* p1, void* p2)
 
     // while running
     while (atomic_get(&ctx->running)) {
-        // poll sockets and receive data
-        int received = udp_rx_receive(&ctx->udp);
-        if (received < 0) {
-            LOG_ERR("connection error: %d", errno);
-        } else if (received > 0) {
-            TF_Accept(&ctx->tf, ctx->udp.rx_buf, received);
+        // sleep until a datagram arrives or the next tinyframe tick is due
+        int timeout_ms = MAX(k_timer_remaining_get(&ctx->tf_tick), 1);
+        ret = udp_rx_wait(&ctx->udp, timeout_ms);
+        if (ret < 0) {
+            k_msleep(timeout_ms);
+        }
+
+        // drain what is pending, bounded so a burst can not starve ticks
+        for (int i = 0; ret > 0 && i < CONFIG_CEREBRI_SYNAPSE_ETH_RX_BATCH; i++) {
+            int received = udp_rx_receive(&ctx->udp);
+            if (received == -EAGAIN) {
+                break;
+            } else if (received < 0) {
+                LOG_ERR("connection error: %d", received);
+                break;
+            } else if (received > 0) {
+                TF_Accept(&ctx->tf, ctx->udp.rx_buf, received);
+            }
         }
 
-        // tell tinyframe time has passed
-        TF_Tick(&ctx->tf);
+        // tell tinyframe how many tick periods have passed
+        for (uint32_t n = k_timer_status_get(&ctx->tf_tick); n > 0; n--) {
+            TF_Tick(&ctx->tf);
+        }
     }
 
     // deconstructor
@@ -195,6 +272,29 @@ static int cmd_status(const struct shell* sh,
     ARG_UNUSED(data);
 
     shell_print(sh, "running: %d", (int)atomic_get(&g_ctx.running));
+    shell_print(sh, "datagrams: %u", g_ctx.udp.datagrams);
+    shell_print(sh, "empty datagrams: %u", g_ctx.udp.empty);
+    shell_print(sh, "frames accepted: %u", g_ctx.accepted);
+    shell_print(sh, "frames decoded: %u", g_ctx.decoded);
+    shell_print(sh, "frames rejected: %u", g_ctx.rejected);
+    shell_print(sh, "frames dropped: %u", g_ctx.dropped);
+    return 0;
+}
+
+static int cmd_reset(const struct shell* sh,
+    size_t argc, char** argv, void* data)
+{
+    ARG_UNUSED(sh);
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+    ARG_UNUSED(data);
+
+    g_ctx.udp.datagrams = 0;
+    g_ctx.udp.empty = 0;
+    g_ctx.accepted = 0;
+    g_ctx.decoded = 0;
+    g_ctx.rejected = 0;
+    g_ctx.dropped = 0;
     return 0;
 }
 
@@ -202,6 +302,7 @@ SHELL_STATIC_SUBCMD_SET_CREATE(sub_syn_eth_rx,
     SHELL_CMD(start, NULL, "start", cmd_start),
     SHELL_CMD(stop, NULL, "stop", cmd_stop),
     SHELL_CMD(status, NULL, "status", cmd_status),
+    SHELL_CMD(reset, NULL, "reset counters", cmd_reset),
     SHELL_SUBCMD_SET_END);
 
 SHELL_CMD_REGISTER(syn_eth_rx, &sub_syn_eth_rx, "syn eth rx commands", NULL);
@@ -7,10 +7,13 @@ struct udp_rx {
     int sock;
     struct sockaddr_in addr;
     char rx_buf[1024];
+    uint32_t datagrams;
+    uint32_t empty; // zero length datagrams, not counted in datagrams
 };
 
 int udp_rx_init(struct udp_rx* ctx);
 int udp_rx_fini(struct udp_rx* ctx);
+int udp_rx_wait(struct udp_rx* ctx, int timeout_ms);
 int udp_rx_receive(struct udp_rx* ctx);
 
 #endif // SYNAPSE_UDP_UDP_RX_H_
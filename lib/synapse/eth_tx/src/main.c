@@ -3,9 +3,12 @@
 
 #include <zros/private/zros_node_struct.h>
 #include <zros/private/zros_sub_struct.h>
+#include <zros/private/zros_topic_struct.h>
+#include <zros/private/zros_waitset_struct.h>
 
 #include <zros/zros_node.h>
 #include <zros/zros_sub.h>
+#include <zros/zros_waitset.h>
 
 #include <pb_encode.h>
 
@@ -22,23 +25,50 @@
 
 LOG_MODULE_REGISTER(syn_eth_tx, LOG_LEVEL_DBG);
 
-#define TOPIC_PUBLISHER(DATA, CLASS, TOPIC)                                   \
-    {                                                                         \
-        TF_Msg msg;                                                           \
-        TF_ClearMsg(&msg);                                                    \
-        uint8_t buf[CLASS##_size];                                            \
-        memset(buf, 0, CLASS##_size);                                         \
-        pb_ostream_t stream = pb_ostream_from_buffer((pu8)buf, sizeof(buf));  \
-        int rc = pb_encode(&stream, CLASS##_fields, DATA);                    \
-        if (rc) {                                                             \
-            msg.type = TOPIC;                                                 \
-            msg.data = buf;                                                   \
-            msg.len = stream.bytes_written;                                   \
-            TF_Send(&ctx->tf, &msg);                                          \
-        } else {                                                              \
-            printf("%s encoding failed: %s\n", #DATA, PB_GET_ERROR(&stream)); \
-        }                                                                     \
-    }
+// tinyframe header and checksums around the payload, from TF_Config.h,
+// the payload checksum is only sent for a non-empty payload
+#if TF_CKSUM_TYPE == TF_CKSUM_NONE
+#define TF_FRAME_CKSUM_BYTES 0
+#else
+#define TF_FRAME_CKSUM_BYTES sizeof(TF_CKSUM)
+#endif
+#define TF_FRAME_OVERHEAD ((TF_USE_SOF_BYTE ? 1 : 0) + TF_ID_BYTES + TF_LEN_BYTES \
+    + TF_TYPE_BYTES + 2 * TF_FRAME_CKSUM_BYTES)
+
+// topics forwarded to the host and their rate limits
+struct tx_topic {
+    struct zros_topic* topic;
+    double rate_hz;
+};
+
+static const struct tx_topic g_tx_topics[] = {
+#ifdef CONFIG_CEREBRI_SYNAPSE_ETH_TX_STATUS
+    { &topic_status, 15 },
+#endif
+#ifdef CONFIG_CEREBRI_SYNAPSE_ETH_TX_ACTUATORS
+    { &topic_actuators, 50 },
+#endif
+#ifdef CONFIG_CEREBRI_SYNAPSE_ETH_TX_IMU
+    { &topic_imu, CONFIG_SYS_CLOCK_TICKS_PER_SEC },
+#endif
+#ifdef CONFIG_CEREBRI_SYNAPSE_ETH_TX_LED_ARRAY
+    { &topic_led_array, 10 },
+#endif
+};
+
+#define TX_TOPIC_COUNT ARRAY_SIZE(g_tx_topics)
+
+BUILD_ASSERT(TX_TOPIC_COUNT > 0, "syn_eth_tx forwards no topics");
+BUILD_ASSERT(TX_TOPIC_COUNT <= CONFIG_CEREBRI_SYNAPSE_ZROS_WAITSET_SIZE,
+    "syn_eth_tx forwards more topics than a waitset holds");
+
+// copy of a message for topics that can not be borrowed in place
+union tx_msg {
+    synapse_msgs_Status status;
+    synapse_msgs_Actuators actuators;
+    synapse_msgs_Imu imu;
+    synapse_msgs_LEDArray led_array;
+};
 
 static K_THREAD_STACK_DEFINE(g_my_stack_area, MY_STACK_SIZE);
 static struct k_thread g_my_thread_data;
@@ -46,11 +76,12 @@ static struct k_thread g_my_thread_data;
 struct context {
     // zros node handle
     struct zros_node node;
-    // subscriptions
-    struct zros_sub
-        sub_status;
+    // subscriptions, one per forwarded topic
+    struct zros_sub subs[TX_TOPIC_COUNT];
+    // bit i of the ready mask is subs[i]
+    struct zros_waitset waitset;
     // topic data
-    synapse_msgs_Status status;
+    union tx_msg msgs[TX_TOPIC_COUNT];
     // connections
     struct udp_tx udp;
     // tinyframe
@@ -61,10 +92,67 @@ struct context {
 
 static struct context g_ctx;
 
+// tinyframe writes frames straight into the pending datagram
 static void tf_write(TinyFrame* tf, const uint8_t* buf, uint32_t len)
 {
     struct context* ctx = tf->userdata;
-    udp_tx_send(&ctx->udp, buf, len);
+    udp_tx_append(&ctx->udp, buf, len);
+}
+
+// nanopb output goes to tinyframe as multipart payload, which checksums it
+// and passes it on to tf_write without another buffer
+static bool tf_stream_write(pb_ostream_t* stream, const pb_byte_t* buf, size_t count)
+{
+    TF_Multipart_Payload(stream->state, buf, count);
+    return true;
+}
+
+// encode with the nanopb descriptor and tinyframe type from the registry
+static void send_topic(struct context* ctx, const struct zros_topic* topic, const void* data)
+{
+    size_t size = 0;
+    if (!pb_get_encoded_size(&size, topic->_fields, data)) {
+        LOG_ERR("%s encoding failed", topic->_name);
+        return;
+    }
+
+    // keep the frame in one datagram if it fits in one
+    udp_tx_reserve(&ctx->udp, size + TF_FRAME_OVERHEAD);
+
+    TF_Msg msg;
+    TF_ClearMsg(&msg);
+    msg.type = topic->_tf_type;
+    msg.len = size;
+    if (!TF_Send_Multipart(&ctx->tf, &msg)) {
+        LOG_ERR("%s send failed", topic->_name);
+        return;
+    }
+    pb_ostream_t stream = {
+        .callback = tf_stream_write,
+        .state = &ctx->tf,
+        .max_size = size,
+    };
+    // the sizing pass above already walked the same fields, so this only
+    // fails on a broken descriptor
+    if (!pb_encode(&stream, topic->_fields, data)) {
+        LOG_ERR("%s encoding failed: %s", topic->_name, PB_GET_ERROR(&stream));
+    }
+    TF_Multipart_Close(&ctx->tf);
+}
+
+// loan mode topics are encoded in place, the others from a copy
+static void forward(struct context* ctx, struct zros_sub* sub)
+{
+    struct zros_topic* topic = sub->_topic;
+    if (topic->_mode == ZROS_TOPIC_MODE_LOAN) {
+        const void* data = NULL;
+        if (zros_sub_borrow(sub, &data) == 0) {
+            send_topic(ctx, topic, data);
+            zros_sub_release(sub);
+        }
+    } else if (zros_sub_update(sub) == 0) {
+        send_topic(ctx, topic, sub->_data);
+    }
 }
 
 static int init(struct context* ctx)
@@ -74,11 +162,19 @@ static int init(struct context* ctx)
     zros_node_init(&ctx->node, "syn_eth_tx");
 
     // initialize node subscriptions
-
-    ret = zros_sub_init(&ctx->sub_status, &ctx->node, &topic_status, &ctx->status, 15);
-    if (ret < 0) {
-        LOG_ERR("sub init status failed: %d", ret);
-        return ret;
+    zros_waitset_init(&ctx->waitset, NULL);
+    for (size_t i = 0; i < TX_TOPIC_COUNT; i++) {
+        const struct tx_topic* tx = &g_tx_topics[i];
+        if (tx->topic->_fields == NULL || tx->topic->_size > (int)sizeof(union tx_msg)) {
+            LOG_ERR("topic %s can not be encoded", tx->topic->_name);
+            return -EINVAL;
+        }
+        ret = zros_sub_init(&ctx->subs[i], &ctx->node, tx->topic, &ctx->msgs[i], tx->rate_hz);
+        if (ret < 0) {
+            LOG_ERR("sub init %s failed: %d", tx->topic->_name, ret);
+            return ret;
+        }
+        zros_waitset_add(&ctx->waitset, &ctx->subs[i]);
     }
 
     // initialize udp
@@ -107,7 +203,9 @@ static int fini(struct context* ctx)
     ret = udp_tx_fini(&ctx->udp);
 
     // close subscriptions
-    zros_sub_fini(&ctx->sub_status);
+    for (size_t i = 0; i < TX_TOPIC_COUNT; i++) {
+        zros_sub_fini(&ctx->subs[i]);
+    }
 
     return ret;
 };
@@ -137,20 +235,19 @@ static void run(void* p0, void* p1, void* p2)
     while (atomic_get(&ctx->running)) {
         int64_t now = k_uptime_ticks();
 
-        struct k_poll_event events[] = {
-            *zros_sub_get_event(&ctx->sub_status),
-        };
-
-        int rc = 0;
-        rc = k_poll(events, ARRAY_SIZE(events), K_MSEC(1000));
+        uint32_t ready = 0;
+        int rc = zros_waitset_wait(&ctx->waitset, K_MSEC(1000), &ready);
         if (rc != 0) {
             LOG_WRN("poll timeout");
         }
 
-        if (zros_sub_update_available(&ctx->sub_status)) {
-            zros_sub_update(&ctx->sub_status);
-            TOPIC_PUBLISHER(&ctx->status, synapse_msgs_Status, SYNAPSE_STATUS_TOPIC);
+        // every topic ready in this cycle goes out in as few datagrams as fit
+        for (size_t i = 0; i < TX_TOPIC_COUNT; i++) {
+            if (ready & BIT(i)) {
+                forward(ctx, &ctx->subs[i]);
+            }
         }
+        udp_tx_flush(&ctx->udp);
 
         if (now - ticks_last_uptime > CONFIG_SYS_CLOCK_TICKS_PER_SEC) {
             ticks_last_uptime = now;
@@ -205,6 +302,7 @@ static int cmd_status(const struct shell* sh,
     size_t argc, char** argv, void* data)
 {
     shell_print(sh, "running: %d", (int)atomic_get(&g_ctx.running));
+    shell_print(sh, "datagrams: %u", g_ctx.udp.datagrams);
     return 0;
 }
 
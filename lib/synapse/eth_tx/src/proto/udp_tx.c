@@ -15,6 +15,15 @@ int udp_tx_init(struct udp_tx* ctx)
     ctx->addr.sin_addr.s_addr = INADDR_ANY;
     ctx->addr.sin_family = AF_INET;
     ctx->addr.sin_port = htons(MY_PORT);
+    ctx->len = 0;
+    ctx->datagrams = 0;
+
+    ctx->dest.sin_family = AF_INET;
+    ctx->dest.sin_port = htons(MY_PORT);
+    if (zsock_inet_pton(AF_INET, CONFIG_NET_CONFIG_PEER_IPV4_ADDR, &ctx->dest.sin_addr) != 1) {
+        LOG_ERR("invalid peer address: %s", CONFIG_NET_CONFIG_PEER_IPV4_ADDR);
+        return -EINVAL;
+    }
 
     ctx->sock = zsock_socket(((struct sockaddr*)&ctx->addr)->sa_family, SOCK_DGRAM, IPPROTO_UDP);
     if (ctx->sock < 0) {
@@ -38,18 +47,12 @@ int udp_tx_fini(struct udp_tx* ctx)
 int udp_tx_send(struct udp_tx* ctx, const uint8_t* buf, size_t len)
 {
     int ret = 0;
-    uint32_t addr;
-    zsock_inet_pton(AF_INET, CONFIG_NET_CONFIG_PEER_IPV4_ADDR, &addr);
-    struct sockaddr_in dest_addr = {
-        .sin_addr.s_addr = addr,
-        .sin_family = AF_INET,
-        .sin_port = htons(MY_PORT)
-    };
-
     ret = zsock_sendto(ctx->sock, buf, len, ZSOCK_MSG_DONTWAIT,
-        (struct sockaddr*)&dest_addr, sizeof(dest_addr));
+        (struct sockaddr*)&ctx->dest, sizeof(ctx->dest));
 
-    if (ret == 0) {
+    if (ret > 0) {
+        ctx->datagrams++;
+    } else if (ret == 0) {
         return -EIO;
     } else if (ret < 0) {
         if (errno == EAGAIN) {
@@ -66,4 +69,42 @@ int udp_tx_send(struct udp_tx* ctx, const uint8_t* buf, size_t len)
     return ret;
 }
 
+// start a frame of at most len bytes, sending the pending datagram first
+// if the frame would not fit in what is left of it
+int udp_tx_reserve(struct udp_tx* ctx, size_t len)
+{
+    if (ctx->len > 0 && ctx->len + len > sizeof(ctx->buf)) {
+        return udp_tx_flush(ctx);
+    }
+    return 0;
+}
+
+// append to the pending datagram, a frame larger than the mtu continues in
+// the next datagram
+int udp_tx_append(struct udp_tx* ctx, const uint8_t* buf, size_t len)
+{
+    int ret = 0;
+    while (len > 0) {
+        size_t n = MIN(len, sizeof(ctx->buf) - ctx->len);
+        memcpy(ctx->buf + ctx->len, buf, n);
+        ctx->len += n;
+        buf += n;
+        len -= n;
+        if (ctx->len == sizeof(ctx->buf)) {
+            ret = udp_tx_flush(ctx);
+        }
+    }
+    return ret;
+}
+
+int udp_tx_flush(struct udp_tx* ctx)
+{
+    if (ctx->len == 0) {
+        return 0;
+    }
+    int ret = udp_tx_send(ctx, ctx->buf, ctx->len);
+    ctx->len = 0;
+    return ret;
+}
+
 // vi: ts=4 sw=4 et
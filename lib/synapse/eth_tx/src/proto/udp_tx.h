@@ -6,11 +6,18 @@
 struct udp_tx {
     int sock;
     struct sockaddr_in addr;
+    struct sockaddr_in dest; // peer, resolved once at init
+    uint8_t buf[CONFIG_CEREBRI_SYNAPSE_ETH_TX_MTU]; // pending datagram
+    size_t len;
+    uint32_t datagrams;
 };
 
 int udp_tx_init(struct udp_tx* ctx);
 int udp_tx_fini(struct udp_tx* ctx);
 int udp_tx_send(struct udp_tx* ctx, const uint8_t* buf, size_t len);
+int udp_tx_reserve(struct udp_tx* ctx, size_t len);
+int udp_tx_append(struct udp_tx* ctx, const uint8_t* buf, size_t len);
+int udp_tx_flush(struct udp_tx* ctx);
 
 #endif // SYNAPSE_UDP_UDP_TX_H_
 // vi: ts=4 sw=4 et
@@ -0,0 +1,396 @@
+/*
+ * Copyright (c) 2024 CogniPilot Foundation
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include <zephyr/fs/fs.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/sys/ring_buffer.h>
+
+#include <zros/private/zros_node_struct.h>
+#include <zros/private/zros_sub_struct.h>
+#include <zros/private/zros_topic_struct.h>
+#include <zros/private/zros_waitset_struct.h>
+#include <zros/zros_broker.h>
+#include <zros/zros_node.h>
+#include <zros/zros_sub.h>
+#include <zros/zros_waitset.h>
+
+#include <pb_encode.h>
+
+#include <cerebri/core/clock.h>
+#include <cerebri/core/workq.h>
+#include <cerebri/synapse/log_format.h>
+
+#include <synapse_topic_list.h>
+
+#define MY_STACK_SIZE 8192
+#define MY_PRIORITY 8
+
+#define MAX_TOPICS CONFIG_CEREBRI_SYNAPSE_LOGGER_MAX_TOPICS
+#define BLOCK_SIZE CONFIG_CEREBRI_SYNAPSE_LOGGER_BLOCK_SIZE
+#define MSG_SIZE CONFIG_CEREBRI_SYNAPSE_LOGGER_MSG_SIZE
+
+BUILD_ASSERT(CONFIG_CEREBRI_SYNAPSE_LOGGER_RING_SIZE % BLOCK_SIZE == 0,
+    "logger ring size must be a multiple of the block size");
+BUILD_ASSERT(MAX_TOPICS <= CONFIG_CEREBRI_SYNAPSE_ZROS_WAITSET_SIZE,
+    "syn_log logs more topics than a waitset holds");
+
+LOG_MODULE_REGISTER(syn_log, CONFIG_CEREBRI_SYNAPSE_LOGGER_LOG_LEVEL);
+
+RING_BUF_DECLARE(g_ring, CONFIG_CEREBRI_SYNAPSE_LOGGER_RING_SIZE);
+
+static K_THREAD_STACK_DEFINE(g_my_stack_area, MY_STACK_SIZE);
+static struct k_thread g_my_thread_data;
+
+struct context {
+    struct zros_node node;
+    // logged topics, chosen before the thread starts
+    struct zros_topic* topics[MAX_TOPICS];
+    struct zros_sub subs[MAX_TOPICS];
+    struct zros_waitset waitset;
+    size_t topic_count;
+    // shared by all subscriptions, they are handled one at a time
+    uint8_t msg[MSG_SIZE] __aligned(8);
+    uint8_t record[SYNAPSE_LOG_RECORD_HEADER_SIZE + MSG_SIZE];
+    // the logger thread puts, the flush work gets, the lock guards the
+    // ring indices only, never the file system
+    struct k_spinlock lock;
+    struct k_work flush_work;
+    atomic_t sync;
+    struct fs_file_t file;
+    atomic_t running; // cleared to ask the thread to stop
+    atomic_t alive; // cleared by the thread once it has stopped
+    // accounting
+    uint32_t logged;
+    uint32_t dropped; // ring full
+    uint32_t failed; // not encodable
+    uint32_t bytes_written;
+    int write_error;
+};
+
+static struct context g_ctx;
+
+// write whole blocks, straight from the ring, on the low priority queue.
+// the read index only ever moves by whole blocks, so with a ring that is a
+// multiple of the block size every claim of a block is contiguous. on sync
+// the partial block at the end goes out as well.
+static void flush_handler(struct k_work* work)
+{
+    struct context* ctx = CONTAINER_OF(work, struct context, flush_work);
+    bool sync = atomic_get(&ctx->sync);
+    while (true) {
+        uint8_t* data = NULL;
+        k_spinlock_key_t key = k_spin_lock(&ctx->lock);
+        uint32_t len = ring_buf_get_claim(&g_ring, &data, BLOCK_SIZE);
+        if (len == 0 || (len < BLOCK_SIZE && !sync)) {
+            ring_buf_get_finish(&g_ring, 0);
+            k_spin_unlock(&ctx->lock, key);
+            break;
+        }
+        k_spin_unlock(&ctx->lock, key);
+
+        ssize_t ret = fs_write(&ctx->file, data, len);
+
+        key = k_spin_lock(&ctx->lock);
+        ring_buf_get_finish(&g_ring, len);
+        k_spin_unlock(&ctx->lock, key);
+
+        if (ret < 0) {
+            // the block is lost, keep draining so logging carries on
+            ctx->write_error = ret;
+        } else {
+            ctx->bytes_written += ret;
+        }
+    }
+    if (sync) {
+        fs_sync(&ctx->file);
+    }
+}
+
+static int open_log(struct context* ctx)
+{
+    fs_file_t_init(&ctx->file);
+    int ret = fs_open(&ctx->file, CONFIG_CEREBRI_SYNAPSE_LOGGER_PATH, FS_O_CREATE | FS_O_WRITE);
+    if (ret < 0) {
+        return ret;
+    }
+    ret = fs_truncate(&ctx->file, 0);
+    if (ret < 0) {
+        fs_close(&ctx->file);
+        return ret;
+    }
+
+    // the magic goes through the ring, so file writes stay block aligned
+    ring_buf_reset(&g_ring);
+    ring_buf_put(&g_ring, (const uint8_t*)SYNAPSE_LOG_MAGIC, SYNAPSE_LOG_MAGIC_SIZE);
+    return 0;
+}
+
+static int init(struct context* ctx)
+{
+    int ret = 0;
+    zros_node_init(&ctx->node, "syn_log");
+
+    ret = open_log(ctx);
+    if (ret < 0) {
+        LOG_ERR("open %s failed: %d", CONFIG_CEREBRI_SYNAPSE_LOGGER_PATH, ret);
+        return ret;
+    }
+
+    zros_waitset_init(&ctx->waitset, NULL);
+    for (size_t i = 0; i < ctx->topic_count; i++) {
+        struct zros_topic* topic = ctx->topics[i];
+        ret = zros_sub_init(&ctx->subs[i], &ctx->node, topic, ctx->msg,
+            CONFIG_CEREBRI_SYNAPSE_LOGGER_RATE_HZ);
+        if (ret < 0) {
+            LOG_ERR("sub init %s failed: %d", topic->_name, ret);
+            return ret;
+        }
+        zros_waitset_add(&ctx->waitset, &ctx->subs[i]);
+    }
+
+    ctx->logged = 0;
+    ctx->dropped = 0;
+    ctx->failed = 0;
+    ctx->bytes_written = 0;
+    ctx->write_error = 0;
+    atomic_set(&ctx->sync, 0);
+    LOG_INF("logging %d topics to %s", (int)ctx->topic_count, CONFIG_CEREBRI_SYNAPSE_LOGGER_PATH);
+    return ret;
+}
+
+static void fini(struct context* ctx)
+{
+    for (size_t i = 0; i < ctx->topic_count; i++) {
+        zros_sub_fini(&ctx->subs[i]);
+    }
+
+    // write out what is left and wait for it
+    struct k_work_sync work_sync;
+    atomic_set(&ctx->sync, 1);
+    k_work_submit_to_queue(&g_background_work_q, &ctx->flush_work);
+    k_work_flush(&ctx->flush_work, &work_sync);
+    fs_close(&ctx->file);
+}
+
+// encode the latest message into a record and put it in the ring whole,
+// or drop it, the logger never waits for the file system. stamped on the
+// core clock, so logs taken on a stepped clock line up with a replay
+static void log_topic(struct context* ctx, struct zros_sub* sub)
+{
+    struct zros_topic* topic = sub->_topic;
+    int64_t ticks = core_clock_ticks();
+    const void* data = NULL;
+    if (topic->_mode == ZROS_TOPIC_MODE_LOAN) {
+        if (zros_sub_borrow(sub, &data) < 0) {
+            return;
+        }
+    } else if (zros_sub_update(sub) < 0) {
+        return;
+    } else {
+        data = sub->_data;
+    }
+
+    pb_ostream_t stream = pb_ostream_from_buffer(ctx->record + SYNAPSE_LOG_RECORD_HEADER_SIZE, MSG_SIZE);
+    bool ok = pb_encode(&stream, topic->_fields, data);
+    if (topic->_mode == ZROS_TOPIC_MODE_LOAN) {
+        zros_sub_release(sub);
+    }
+    if (!ok) {
+        ctx->failed++;
+        LOG_ERR("%s encoding failed: %s", topic->_name, PB_GET_ERROR(&stream));
+        return;
+    }
+
+    synapse_log_put_record_header(ctx->record, k_ticks_to_ns_floor64(ticks),
+        topic->_tf_type, stream.bytes_written);
+    uint32_t len = SYNAPSE_LOG_RECORD_HEADER_SIZE + stream.bytes_written;
+
+    k_spinlock_key_t key = k_spin_lock(&ctx->lock);
+    if (ring_buf_space_get(&g_ring) < len) {
+        k_spin_unlock(&ctx->lock, key);
+        ctx->dropped++;
+        return;
+    }
+    ring_buf_put(&g_ring, ctx->record, len);
+    uint32_t used = ring_buf_size_get(&g_ring);
+    k_spin_unlock(&ctx->lock, key);
+    ctx->logged++;
+
+    if (used >= BLOCK_SIZE) {
+        k_work_submit_to_queue(&g_background_work_q, &ctx->flush_work);
+    }
+}
+
+static void run(void* p0, void* p1, void* p2)
+{
+    struct context* ctx = p0;
+    ARG_UNUSED(p1);
+    ARG_UNUSED(p2);
+
+    int ret = init(ctx);
+    if (ret < 0) {
+        LOG_ERR("init failed: %d", ret);
+        atomic_set(&ctx->running, 0);
+        atomic_set(&ctx->alive, 0);
+        return;
+    }
+
+    while (atomic_get(&ctx->running)) {
+        // wakes up at least once a second to notice a stop
+        uint32_t ready = 0;
+        zros_waitset_wait(&ctx->waitset, K_MSEC(1000), &ready);
+
+        for (size_t i = 0; i < ctx->topic_count; i++) {
+            if (ready & BIT(i)) {
+                log_topic(ctx, &ctx->subs[i]);
+            }
+        }
+    }
+
+    fini(ctx);
+    LOG_INF("stopped, %u bytes written", ctx->bytes_written);
+    atomic_set(&ctx->alive, 0);
+}
+
+// resolve space separated topic names, every one must be encodable
+static int select_topics(struct context* ctx, size_t argc, char** argv)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < argc; i++) {
+        struct zros_topic* topic = zros_broker_find_topic(argv[i]);
+        if (topic == NULL || topic->_fields == NULL || topic->_tf_type < 0
+            || topic->_size > MSG_SIZE) {
+            LOG_ERR("topic %s can not be logged", argv[i]);
+            return -EINVAL;
+        }
+        if (count == MAX_TOPICS) {
+            LOG_ERR("more than %d topics", MAX_TOPICS);
+            return -ENOMEM;
+        }
+        ctx->topics[count++] = topic;
+    }
+    ctx->topic_count = count;
+    return 0;
+}
+
+static int select_default_topics(struct context* ctx)
+{
+    static char names[] = CONFIG_CEREBRI_SYNAPSE_LOGGER_TOPICS;
+    char* argv[MAX_TOPICS + 1];
+    size_t argc = 0;
+    char* save = NULL;
+    for (char* name = strtok_r(names, " ", &save); name != NULL && argc < ARRAY_SIZE(argv);
+         name = strtok_r(NULL, " ", &save)) {
+        argv[argc++] = name;
+    }
+    return select_topics(ctx, argc, argv);
+}
+
+// the thread and its topics are reused, so only once the last one is gone
+static int start()
+{
+    if (!atomic_cas(&g_ctx.alive, 0, 1)) {
+        return -EBUSY;
+    }
+    atomic_set(&g_ctx.running, 1);
+    k_tid_t tid = k_thread_create(&g_my_thread_data, g_my_stack_area,
+        K_THREAD_STACK_SIZEOF(g_my_stack_area),
+        run,
+        &g_ctx, NULL, NULL,
+        MY_PRIORITY, 0, K_FOREVER);
+    k_thread_name_set(tid, "syn_log");
+    k_thread_start(tid);
+    return 0;
+}
+
+static int cmd_start(const struct shell* sh,
+    size_t argc, char** argv, void* data)
+{
+    ARG_UNUSED(data);
+
+    if (atomic_get(&g_ctx.running)) {
+        shell_print(sh, "already running");
+        return 0;
+    }
+    if (atomic_get(&g_ctx.alive)) {
+        shell_print(sh, "still stopping, try again");
+        return -EBUSY;
+    }
+    int ret = argc > 1 ? select_topics(&g_ctx, argc - 1, &argv[1]) : 0;
+    if (ret < 0) {
+        shell_print(sh, "bad topic list");
+        return ret;
+    }
+    ret = start();
+    if (ret < 0) {
+        shell_print(sh, "still stopping, try again");
+    }
+    return ret;
+}
+
+static int cmd_stop(const struct shell* sh,
+    size_t argc, char** argv, void* data)
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+    ARG_UNUSED(data);
+
+    if (atomic_get(&g_ctx.running)) {
+        atomic_set(&g_ctx.running, 0);
+    } else {
+        shell_print(sh, "not running");
+    }
+    return 0;
+}
+
+static int cmd_status(const struct shell* sh,
+    size_t argc, char** argv, void* data)
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+    ARG_UNUSED(data);
+
+    shell_print(sh, "running: %d", (int)atomic_get(&g_ctx.running));
+    shell_print(sh, "file: %s", CONFIG_CEREBRI_SYNAPSE_LOGGER_PATH);
+    for (size_t i = 0; i < g_ctx.topic_count; i++) {
+        shell_print(sh, "topic: %s", g_ctx.topics[i]->_name);
+    }
+    shell_print(sh, "logged: %u", g_ctx.logged);
+    shell_print(sh, "dropped: %u", g_ctx.dropped);
+    shell_print(sh, "failed: %u", g_ctx.failed);
+    shell_print(sh, "buffered: %u / %u", ring_buf_size_get(&g_ring), ring_buf_capacity_get(&g_ring));
+    shell_print(sh, "written: %u", g_ctx.bytes_written);
+    shell_print(sh, "write error: %d", g_ctx.write_error);
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_syn_log,
+    SHELL_CMD(start, NULL, "start [topic ...]", cmd_start),
+    SHELL_CMD(stop, NULL, "stop", cmd_stop),
+    SHELL_CMD(status, NULL, "status", cmd_status),
+    SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(syn_log, &sub_syn_log, "syn topic logger commands", NULL);
+
+static int logger_init()
+{
+    k_work_init(&g_ctx.flush_work, flush_handler);
+    int ret = select_default_topics(&g_ctx);
+    if (ret < 0) {
+        return ret;
+    }
+    if (IS_ENABLED(CONFIG_CEREBRI_SYNAPSE_LOGGER_AUTOSTART)) {
+        start();
+    }
+    return 0;
+}
+
+SYS_INIT(logger_init, APPLICATION, 0);
+
+// vi: ts=4 sw=4 et
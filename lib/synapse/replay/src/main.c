@@ -0,0 +1,331 @@
+/*
+ * Copyright (c) 2024 CogniPilot Foundation
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/sys/crc.h>
+
+#include <zros/private/zros_node_struct.h>
+#include <zros/private/zros_pub_struct.h>
+#include <zros/private/zros_sub_struct.h>
+#include <zros/private/zros_topic_struct.h>
+#include <zros/private/zros_waitset_struct.h>
+#include <zros/zros_node.h>
+#include <zros/zros_pub.h>
+#include <zros/zros_sub.h>
+#include <zros/zros_waitset.h>
+
+#include <pb_decode.h>
+#include <pb_encode.h>
+
+#include <cerebri/core/clock.h>
+#include <cerebri/synapse/log_format.h>
+
+#include <synapse_topic_list.h>
+
+#include "replay_bottom.h"
+
+#ifdef CONFIG_CEREBRI_SYNAPSE_REPLAY_EXIT
+#include <posix_board_if.h>
+#endif
+
+#define MY_STACK_SIZE 8192
+#define MY_PRIORITY 1
+
+#define MSG_SIZE CONFIG_CEREBRI_SYNAPSE_REPLAY_MSG_SIZE
+
+LOG_MODULE_REGISTER(syn_replay, CONFIG_CEREBRI_SYNAPSE_REPLAY_LOG_LEVEL);
+
+// topics replayed from the log, other records are skipped
+static struct zros_topic* const g_replay_topics[] = {
+    &topic_joy,
+    &topic_road_curve_angle,
+    &topic_imu,
+};
+
+#define REPLAY_TOPIC_COUNT ARRAY_SIZE(g_replay_topics)
+
+// copy of a message for topics that can not be loaned
+union replay_msg {
+    synapse_msgs_Joy joy;
+    synapse_msgs_RoadCurveAngle road_curve_angle;
+    synapse_msgs_Imu imu;
+};
+
+static K_THREAD_STACK_DEFINE(g_my_stack_area, MY_STACK_SIZE);
+static struct k_thread g_my_thread_data;
+
+struct context {
+    struct zros_node node;
+    struct zros_pub pubs[REPLAY_TOPIC_COUNT];
+    union replay_msg msgs[REPLAY_TOPIC_COUNT];
+    // the output, checksummed in encoded form so struct padding is ignored
+    struct zros_sub sub_actuators;
+    struct zros_waitset waitset;
+    synapse_msgs_Actuators actuators;
+    uint8_t record[SYNAPSE_LOG_RECORD_HEADER_SIZE + MSG_SIZE];
+    char path[64];
+    int fd;
+    atomic_t running;
+    // summary
+    uint32_t replayed;
+    uint32_t skipped;
+    uint32_t actuators_count;
+    uint32_t actuators_crc;
+};
+
+static struct context g_ctx = {
+    .path = CONFIG_CEREBRI_SYNAPSE_REPLAY_PATH,
+};
+
+static int replay_index(const struct zros_topic* topic)
+{
+    for (size_t i = 0; i < REPLAY_TOPIC_COUNT; i++) {
+        if (g_replay_topics[i] == topic) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int init(struct context* ctx)
+{
+    int ret = 0;
+    zros_node_init(&ctx->node, "syn_replay");
+
+    ctx->fd = synapse_replay_bottom_open(ctx->path);
+    if (ctx->fd < 0) {
+        LOG_ERR("open %s failed: %d", ctx->path, ctx->fd);
+        return ctx->fd;
+    }
+    uint8_t magic[SYNAPSE_LOG_MAGIC_SIZE];
+    if (synapse_replay_bottom_read(ctx->fd, magic, sizeof(magic)) != sizeof(magic)
+        || memcmp(magic, SYNAPSE_LOG_MAGIC, sizeof(magic)) != 0) {
+        LOG_ERR("%s: not a synapse log", ctx->path);
+        synapse_replay_bottom_close(ctx->fd);
+        return -EINVAL;
+    }
+
+    for (size_t i = 0; i < REPLAY_TOPIC_COUNT; i++) {
+        struct zros_topic* topic = g_replay_topics[i];
+        void* data = topic->_mode == ZROS_TOPIC_MODE_LOAN ? topic->_data : &ctx->msgs[i];
+        ret = zros_pub_init(&ctx->pubs[i], &ctx->node, topic, data);
+        if (ret < 0) {
+            LOG_ERR("pub init %s failed: %d", topic->_name, ret);
+            return ret;
+        }
+    }
+    ret = zros_sub_init(&ctx->sub_actuators, &ctx->node, &topic_actuators, &ctx->actuators,
+        CONFIG_SYS_CLOCK_TICKS_PER_SEC);
+    if (ret < 0) {
+        LOG_ERR("sub init actuators failed: %d", ret);
+        return ret;
+    }
+    zros_waitset_init(&ctx->waitset, NULL);
+    zros_waitset_add(&ctx->waitset, &ctx->sub_actuators);
+
+    ctx->replayed = 0;
+    ctx->skipped = 0;
+    ctx->actuators_count = 0;
+    ctx->actuators_crc = 0;
+    return ret;
+}
+
+static void fini(struct context* ctx)
+{
+    for (size_t i = 0; i < REPLAY_TOPIC_COUNT; i++) {
+        zros_pub_fini(&ctx->pubs[i]);
+    }
+    zros_sub_fini(&ctx->sub_actuators);
+    synapse_replay_bottom_close(ctx->fd);
+}
+
+// fold every actuators message published until the deadline into the crc
+static void checksum_until(struct context* ctx, int64_t deadline)
+{
+    while (k_uptime_ticks() < deadline) {
+        uint32_t ready = 0;
+        if (zros_waitset_wait_until(&ctx->waitset, deadline, &ready) != 0 || !ready) {
+            continue;
+        }
+        zros_sub_update(&ctx->sub_actuators);
+        uint8_t buf[synapse_msgs_Actuators_size];
+        pb_ostream_t stream = pb_ostream_from_buffer(buf, sizeof(buf));
+        if (pb_encode(&stream, synapse_msgs_Actuators_fields, &ctx->actuators)) {
+            ctx->actuators_crc = crc32_ieee_update(ctx->actuators_crc, buf, stream.bytes_written);
+            ctx->actuators_count++;
+        }
+    }
+}
+
+static void publish(struct context* ctx, int type, const uint8_t* data, uint16_t len)
+{
+    struct zros_topic* topic = synapse_topic_from_tf_type(type);
+    int i = topic == NULL ? -1 : replay_index(topic);
+    if (i < 0 || len > topic->_encoded_size) {
+        ctx->skipped++;
+        return;
+    }
+
+    struct zros_pub* pub = &ctx->pubs[i];
+    void* msg = &ctx->msgs[i];
+    if (topic->_mode == ZROS_TOPIC_MODE_LOAN && zros_pub_loan(pub, &msg) < 0) {
+        ctx->skipped++;
+        return;
+    }
+    memset(msg, 0, topic->_size);
+    pb_istream_t stream = pb_istream_from_buffer(data, len);
+    bool ok = pb_decode(&stream, topic->_fields, msg);
+    if (topic->_mode == ZROS_TOPIC_MODE_LOAN && ok) {
+        zros_pub_commit(pub);
+    } else if (topic->_mode == ZROS_TOPIC_MODE_LOAN) {
+        zros_pub_cancel(pub);
+    } else if (ok) {
+        zros_pub_update(pub);
+    }
+    if (ok) {
+        ctx->replayed++;
+    } else {
+        ctx->skipped++;
+        LOG_WRN("%s decoding failed: %s", topic->_name, PB_GET_ERROR(&stream));
+    }
+}
+
+static void run(void* p0, void* p1, void* p2)
+{
+    struct context* ctx = p0;
+    ARG_UNUSED(p1);
+    ARG_UNUSED(p2);
+
+    int ret = init(ctx);
+    if (ret < 0) {
+        LOG_ERR("init failed: %d", ret);
+        atomic_set(&ctx->running, 0);
+        return;
+    }
+
+    // log times count from the first record, clock time from here
+    LOG_INF("replaying %s", ctx->path);
+    core_clock_reset();
+    int64_t epoch = core_clock_epoch();
+    bool first = true;
+    uint64_t t0_ns = 0;
+
+    while (atomic_get(&ctx->running)) {
+        if (synapse_replay_bottom_read(ctx->fd, ctx->record, SYNAPSE_LOG_RECORD_HEADER_SIZE)
+            != SYNAPSE_LOG_RECORD_HEADER_SIZE) {
+            break;
+        }
+        struct synapse_log_record_header hdr;
+        synapse_log_get_record_header(ctx->record, &hdr);
+        if (hdr.len > MSG_SIZE) {
+            LOG_ERR("record too large: %d", hdr.len);
+            break;
+        }
+        if (synapse_replay_bottom_read(ctx->fd, ctx->record + SYNAPSE_LOG_RECORD_HEADER_SIZE, hdr.len)
+            != hdr.len) {
+            break;
+        }
+        if (first) {
+            t0_ns = hdr.t_ns;
+            first = false;
+        }
+
+        checksum_until(ctx, epoch + k_ns_to_ticks_ceil64(hdr.t_ns - t0_ns));
+        publish(ctx, hdr.type, ctx->record + SYNAPSE_LOG_RECORD_HEADER_SIZE, hdr.len);
+    }
+
+    // let the pipeline answer the last message
+    checksum_until(ctx, k_uptime_ticks() + k_ms_to_ticks_ceil64(1000));
+    LOG_INF("replay done: %u replayed, %u skipped, %u actuators, crc %08x",
+        ctx->replayed, ctx->skipped, ctx->actuators_count, ctx->actuators_crc);
+    fini(ctx);
+    atomic_set(&ctx->running, 0);
+
+#ifdef CONFIG_CEREBRI_SYNAPSE_REPLAY_EXIT
+    // give the deferred log a moment to print the summary
+    k_msleep(100);
+    posix_exit(0);
+#endif
+}
+
+static int start(int32_t delay_ms)
+{
+    atomic_set(&g_ctx.running, 1);
+    k_tid_t tid = k_thread_create(&g_my_thread_data, g_my_stack_area,
+        K_THREAD_STACK_SIZEOF(g_my_stack_area),
+        run,
+        &g_ctx, NULL, NULL,
+        MY_PRIORITY, 0, K_MSEC(delay_ms));
+    k_thread_name_set(tid, "syn_replay");
+    return 0;
+}
+
+static int cmd_start(const struct shell* sh,
+    size_t argc, char** argv, void* data)
+{
+    ARG_UNUSED(data);
+
+    if (atomic_get(&g_ctx.running)) {
+        shell_print(sh, "already running");
+        return 0;
+    }
+    if (argc > 1) {
+        strncpy(g_ctx.path, argv[1], sizeof(g_ctx.path) - 1);
+    }
+    start(0);
+    return 0;
+}
+
+static int cmd_stop(const struct shell* sh,
+    size_t argc, char** argv, void* data)
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+    ARG_UNUSED(data);
+
+    if (atomic_get(&g_ctx.running)) {
+        atomic_set(&g_ctx.running, 0);
+    } else {
+        shell_print(sh, "not running");
+    }
+    return 0;
+}
+
+static int cmd_status(const struct shell* sh,
+    size_t argc, char** argv, void* data)
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+    ARG_UNUSED(data);
+
+    shell_print(sh, "running: %d", (int)atomic_get(&g_ctx.running));
+    shell_print(sh, "log: %s", g_ctx.path);
+    shell_print(sh, "replayed: %u", g_ctx.replayed);
+    shell_print(sh, "skipped: %u", g_ctx.skipped);
+    shell_print(sh, "actuators: %u crc %08x", g_ctx.actuators_count, g_ctx.actuators_crc);
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_syn_replay,
+    SHELL_CMD(start, NULL, "start [log]", cmd_start),
+    SHELL_CMD(stop, NULL, "stop", cmd_stop),
+    SHELL_CMD(status, NULL, "status", cmd_status),
+    SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(syn_replay, &sub_syn_replay, "syn log replay commands", NULL);
+
+#ifdef CONFIG_CEREBRI_SYNAPSE_REPLAY_AUTOSTART
+static int replay_autostart()
+{
+    return start(CONFIG_CEREBRI_SYNAPSE_REPLAY_DELAY_MS);
+}
+
+SYS_INIT(replay_autostart, APPLICATION, 0);
+#endif
+
+// vi: ts=4 sw=4 et
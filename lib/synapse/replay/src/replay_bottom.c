@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2024 CogniPilot Foundation
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "replay_bottom.h"
+
+int synapse_replay_bottom_open(const char* path)
+{
+    int fd = open(path, O_RDONLY);
+    return fd < 0 ? -errno : fd;
+}
+
+// reads len bytes unless the file ends first
+int synapse_replay_bottom_read(int fd, void* buf, uint32_t len)
+{
+    uint32_t total = 0;
+    while (total < len) {
+        ssize_t n = read(fd, (char*)buf + total, len - total);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0) {
+            return -errno;
+        } else if (n == 0) {
+            break;
+        }
+        total += n;
+    }
+    return total;
+}
+
+int synapse_replay_bottom_close(int fd)
+{
+    return close(fd) < 0 ? -errno : 0;
+}
+
+// vi: ts=4 sw=4 et
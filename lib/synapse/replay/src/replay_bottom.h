@@ -0,0 +1,16 @@
+/*
+ * Copyright (c) 2024 CogniPilot Foundation
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef SYNAPSE_REPLAY_BOTTOM_H
+#define SYNAPSE_REPLAY_BOTTOM_H
+
+#include <stdint.h>
+
+// host side of the log replay, return a descriptor, a count or -errno
+int synapse_replay_bottom_open(const char* path);
+int synapse_replay_bottom_read(int fd, void* buf, uint32_t len);
+int synapse_replay_bottom_close(int fd);
+
+#endif // SYNAPSE_REPLAY_BOTTOM_H
+// vi: ts=4 sw=4 et
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2024 CogniPilot Foundation
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef SYNAPSE_SHM_LAYOUT_H
+#define SYNAPSE_SHM_LAYOUT_H
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+
+/********************************************************************
+ * synapse shared memory layout, shared with host tools
+ *
+ * header | topic table | slots
+ *
+ * each topic has one slot holding its latest nanopb encoded message,
+ * encoded like the payload of a tinyframe of the topic's type. a slot is a
+ * seqlock with a single writer, the writer makes seq odd, writes len and
+ * data, then makes seq even again, a reader retries while seq is odd or
+ * changed during its copy, up to SYNAPSE_SHM_READ_RETRIES times, so a
+ * writer that died mid write can not hang it. magic is written last, once
+ * the table is valid.
+ ********************************************************************/
+
+#define SYNAPSE_SHM_MAGIC 0x534e5953 // "SYNS"
+#define SYNAPSE_SHM_VERSION 1
+#define SYNAPSE_SHM_NAME_LEN 32
+#define SYNAPSE_SHM_READ_RETRIES 16
+
+enum synapse_shm_dir {
+    SYNAPSE_SHM_DIR_TX = 0, // written by cerebri
+    SYNAPSE_SHM_DIR_RX = 1, // written by a host tool
+};
+
+struct synapse_shm_topic {
+    char name[SYNAPSE_SHM_NAME_LEN];
+    int32_t tf_type;
+    uint32_t dir;
+    uint32_t offset; // of the slot from the start of the segment
+    uint32_t capacity; // largest encoded message
+};
+
+struct synapse_shm_slot {
+    uint32_t seq;
+    uint32_t len;
+    uint8_t data[];
+};
+
+struct synapse_shm_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size; // of the whole segment
+    uint32_t topic_count;
+    struct synapse_shm_topic topics[];
+};
+
+static inline struct synapse_shm_slot* synapse_shm_slot(struct synapse_shm_header* hdr, uint32_t i)
+{
+    return (struct synapse_shm_slot*)((uint8_t*)hdr + hdr->topics[i].offset);
+}
+
+static inline uint32_t synapse_shm_seq(const struct synapse_shm_slot* slot)
+{
+    return __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+}
+
+// returns where to write the message, call synapse_shm_write_end after
+static inline uint8_t* synapse_shm_write_begin(struct synapse_shm_slot* slot)
+{
+    __atomic_store_n(&slot->seq, slot->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    return slot->data;
+}
+
+static inline void synapse_shm_write_end(struct synapse_shm_slot* slot, uint32_t len)
+{
+    __atomic_store_n(&slot->len, len, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->seq, slot->seq + 1, __ATOMIC_RELEASE);
+}
+
+// copy the latest message into buf, returns its length, 0 if none was
+// written yet, -EMSGSIZE if it does not fit in n, or -EAGAIN if the writer
+// held the slot for every retry, seq is set to the version read
+static inline int32_t synapse_shm_read(const struct synapse_shm_slot* slot, uint8_t* buf,
+    uint32_t n, uint32_t* seq)
+{
+    for (int i = 0; i < SYNAPSE_SHM_READ_RETRIES; i++) {
+        uint32_t start = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        if (start & 1) {
+            continue;
+        }
+        uint32_t len = __atomic_load_n(&slot->len, __ATOMIC_RELAXED);
+        memcpy(buf, slot->data, len < n ? len : n);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) == start) {
+            *seq = start;
+            return len > n ? -EMSGSIZE : (int32_t)len;
+        }
+    }
+    return -EAGAIN;
+}
+
+#endif // SYNAPSE_SHM_LAYOUT_H
+// vi: ts=4 sw=4 et
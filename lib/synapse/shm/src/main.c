@@ -0,0 +1,371 @@
+/*
+ * Copyright (c) 2024 CogniPilot Foundation
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <zephyr/logging/log.h>
+#include <zephyr/shell/shell.h>
+
+#include <zros/private/zros_node_struct.h>
+#include <zros/private/zros_pub_struct.h>
+#include <zros/private/zros_sub_struct.h>
+#include <zros/private/zros_topic_struct.h>
+#include <zros/private/zros_waitset_struct.h>
+#include <zros/zros_broker.h>
+#include <zros/zros_node.h>
+#include <zros/zros_pub.h>
+#include <zros/zros_sub.h>
+#include <zros/zros_waitset.h>
+
+#include <pb_decode.h>
+#include <pb_encode.h>
+
+#include <synapse_shm/synapse_shm_layout.h>
+#include <synapse_topic_list.h>
+
+#include "shm_bottom.h"
+
+#define MY_STACK_SIZE 8192
+#define MY_PRIORITY 1
+
+#define MAX_TOPICS CONFIG_CEREBRI_SYNAPSE_SHM_MAX_TOPICS
+
+LOG_MODULE_REGISTER(syn_shm, CONFIG_CEREBRI_SYNAPSE_SHM_LOG_LEVEL);
+
+BUILD_ASSERT(MAX_TOPICS <= CONFIG_CEREBRI_SYNAPSE_ZROS_WAITSET_SIZE,
+    "syn_shm maps more topics than a waitset holds");
+
+// topics written by host tools, all in loan mode, like syn_eth_rx
+static struct zros_topic* const g_rx_topics[] = {
+    &topic_joy,
+    &topic_road_curve_angle,
+};
+
+static K_THREAD_STACK_DEFINE(g_my_stack_area, MY_STACK_SIZE);
+static struct k_thread g_my_thread_data;
+
+struct context {
+    struct zros_node node;
+    // segment
+    struct synapse_shm_header* hdr;
+    uint32_t size;
+    // topics cerebri writes, table index of each
+    struct zros_sub subs[MAX_TOPICS];
+    struct zros_waitset waitset;
+    uint32_t tx_index[MAX_TOPICS];
+    size_t tx_count;
+    // topics host tools write
+    struct zros_pub pubs[ARRAY_SIZE(g_rx_topics)];
+    uint32_t rx_index[ARRAY_SIZE(g_rx_topics)];
+    uint32_t rx_seq[ARRAY_SIZE(g_rx_topics)];
+    // shared by all subscriptions, they are handled one at a time
+    uint8_t msg[CONFIG_CEREBRI_SYNAPSE_SHM_MSG_SIZE] __aligned(8);
+    uint32_t written;
+    uint32_t read;
+    uint32_t busy; // reads given up on while the host was writing
+    atomic_t running;
+};
+
+static struct context g_ctx;
+
+static bool is_rx(const struct zros_topic* topic)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(g_rx_topics); i++) {
+        if (g_rx_topics[i] == topic) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// lay out the table and slots for every bridged topic, returns the count
+static uint32_t layout(struct synapse_shm_header* hdr, uint32_t* size)
+{
+    uint32_t count = 0;
+    for (size_t i = 0; i < zros_broker_topic_count(); i++) {
+        const struct zros_topic* topic = zros_broker_get_topic(i);
+        if (topic->_fields != NULL && topic->_tf_type >= 0) {
+            count++;
+        }
+    }
+
+    uint32_t offset = ROUND_UP(sizeof(struct synapse_shm_header)
+            + count * sizeof(struct synapse_shm_topic),
+        8);
+    uint32_t n = 0;
+    for (size_t i = 0; i < zros_broker_topic_count(); i++) {
+        const struct zros_topic* topic = zros_broker_get_topic(i);
+        if (topic->_fields == NULL || topic->_tf_type < 0) {
+            continue;
+        }
+        if (hdr != NULL) {
+            struct synapse_shm_topic* entry = &hdr->topics[n];
+            strncpy(entry->name, topic->_name, sizeof(entry->name) - 1);
+            entry->tf_type = topic->_tf_type;
+            entry->dir = is_rx(topic) ? SYNAPSE_SHM_DIR_RX : SYNAPSE_SHM_DIR_TX;
+            entry->offset = offset;
+            entry->capacity = topic->_encoded_size;
+        }
+        offset += ROUND_UP(sizeof(struct synapse_shm_slot) + topic->_encoded_size, 8);
+        n++;
+    }
+    *size = offset;
+    return count;
+}
+
+static int table_index(const struct synapse_shm_header* hdr, const struct zros_topic* topic)
+{
+    for (uint32_t i = 0; i < hdr->topic_count; i++) {
+        if (strcmp(hdr->topics[i].name, topic->_name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int init(struct context* ctx)
+{
+    int ret = 0;
+    zros_node_init(&ctx->node, "syn_shm");
+
+    // map the segment and publish the table
+    uint32_t count = layout(NULL, &ctx->size);
+    ret = synapse_shm_bottom_open(CONFIG_CEREBRI_SYNAPSE_SHM_NAME, ctx->size, (void**)&ctx->hdr);
+    if (ret < 0) {
+        LOG_ERR("shm open %s failed: %d", CONFIG_CEREBRI_SYNAPSE_SHM_NAME, ret);
+        return ret;
+    }
+    layout(ctx->hdr, &ctx->size);
+    ctx->hdr->version = SYNAPSE_SHM_VERSION;
+    ctx->hdr->size = ctx->size;
+    ctx->hdr->topic_count = count;
+
+    // subscribe to every topic cerebri writes
+    zros_waitset_init(&ctx->waitset, NULL);
+    ctx->tx_count = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        const struct synapse_shm_topic* entry = &ctx->hdr->topics[i];
+        struct zros_topic* topic = zros_broker_find_topic(entry->name);
+        if (entry->dir != SYNAPSE_SHM_DIR_TX) {
+            continue;
+        }
+        if (ctx->tx_count == MAX_TOPICS || topic->_size > (int)sizeof(ctx->msg)) {
+            LOG_ERR("topic %s can not be mapped", topic->_name);
+            return -ENOMEM;
+        }
+        ret = zros_sub_init(&ctx->subs[ctx->tx_count], &ctx->node, topic, ctx->msg,
+            CONFIG_SYS_CLOCK_TICKS_PER_SEC);
+        if (ret < 0) {
+            LOG_ERR("sub init %s failed: %d", topic->_name, ret);
+            return ret;
+        }
+        zros_waitset_add(&ctx->waitset, &ctx->subs[ctx->tx_count]);
+        ctx->tx_index[ctx->tx_count++] = i;
+    }
+
+    // publish what host tools write
+    for (size_t i = 0; i < ARRAY_SIZE(g_rx_topics); i++) {
+        struct zros_topic* topic = g_rx_topics[i];
+        int index = table_index(ctx->hdr, topic);
+        if (index < 0 || topic->_mode != ZROS_TOPIC_MODE_LOAN
+            || topic->_encoded_size > sizeof(ctx->msg)) {
+            LOG_ERR("topic %s can not be mapped", topic->_name);
+            return -EINVAL;
+        }
+        ret = zros_pub_init(&ctx->pubs[i], &ctx->node, topic, topic->_data);
+        if (ret < 0) {
+            LOG_ERR("pub init %s failed: %d", topic->_name, ret);
+            return ret;
+        }
+        ctx->rx_index[i] = index;
+        ctx->rx_seq[i] = 0;
+    }
+
+    ctx->written = 0;
+    ctx->read = 0;
+    ctx->busy = 0;
+    __atomic_store_n(&ctx->hdr->magic, SYNAPSE_SHM_MAGIC, __ATOMIC_RELEASE);
+    LOG_INF("mapped %d topics to %s", count, CONFIG_CEREBRI_SYNAPSE_SHM_NAME);
+    return ret;
+}
+
+static void fini(struct context* ctx)
+{
+    for (size_t i = 0; i < ctx->tx_count; i++) {
+        zros_sub_fini(&ctx->subs[i]);
+    }
+    for (size_t i = 0; i < ARRAY_SIZE(g_rx_topics); i++) {
+        zros_pub_fini(&ctx->pubs[i]);
+    }
+    synapse_shm_bottom_close(CONFIG_CEREBRI_SYNAPSE_SHM_NAME, ctx->size, ctx->hdr);
+    ctx->hdr = NULL;
+}
+
+// encode the latest message straight into the slot
+static void write_topic(struct context* ctx, struct zros_sub* sub, uint32_t index)
+{
+    struct zros_topic* topic = sub->_topic;
+    const void* data = NULL;
+    if (topic->_mode == ZROS_TOPIC_MODE_LOAN) {
+        if (zros_sub_borrow(sub, &data) < 0) {
+            return;
+        }
+    } else if (zros_sub_update(sub) < 0) {
+        return;
+    } else {
+        data = sub->_data;
+    }
+
+    struct synapse_shm_slot* slot = synapse_shm_slot(ctx->hdr, index);
+    pb_ostream_t stream = pb_ostream_from_buffer(synapse_shm_write_begin(slot),
+        ctx->hdr->topics[index].capacity);
+    if (pb_encode(&stream, topic->_fields, data)) {
+        synapse_shm_write_end(slot, stream.bytes_written);
+        ctx->written++;
+    } else {
+        // leaves an empty message behind, the host sees len 0
+        synapse_shm_write_end(slot, 0);
+        LOG_ERR("%s encoding failed: %s", topic->_name, PB_GET_ERROR(&stream));
+    }
+
+    if (topic->_mode == ZROS_TOPIC_MODE_LOAN) {
+        zros_sub_release(sub);
+    }
+}
+
+// decode a message a host tool wrote since the last poll into a loaned buffer
+static void read_topic(struct context* ctx, size_t i)
+{
+    const struct synapse_shm_slot* slot = synapse_shm_slot(ctx->hdr, ctx->rx_index[i]);
+    if (synapse_shm_seq(slot) == ctx->rx_seq[i]) {
+        return;
+    }
+
+    uint32_t seq = 0;
+    int32_t len = synapse_shm_read(slot, ctx->msg, sizeof(ctx->msg), &seq);
+    if (len == -EAGAIN) {
+        // the host is mid write, rx_seq is unchanged so the next poll retries
+        ctx->busy++;
+        return;
+    }
+    ctx->rx_seq[i] = seq;
+    if (len <= 0) {
+        return;
+    }
+
+    struct zros_topic* topic = g_rx_topics[i];
+    void* msg = NULL;
+    if (zros_pub_loan(&ctx->pubs[i], &msg) < 0) {
+        return;
+    }
+    memset(msg, 0, topic->_size);
+    pb_istream_t stream = pb_istream_from_buffer(ctx->msg, len);
+    if (pb_decode(&stream, topic->_fields, msg)) {
+        zros_pub_commit(&ctx->pubs[i]);
+        ctx->read++;
+    } else {
+        zros_pub_cancel(&ctx->pubs[i]);
+        LOG_WRN("%s decoding failed: %s", topic->_name, PB_GET_ERROR(&stream));
+    }
+}
+
+static void run(void* p0, void* p1, void* p2)
+{
+    struct context* ctx = p0;
+    ARG_UNUSED(p1);
+    ARG_UNUSED(p2);
+
+    int ret = init(ctx);
+    if (ret < 0) {
+        LOG_ERR("init failed: %d", ret);
+        atomic_set(&ctx->running, 0);
+        return;
+    }
+
+    while (atomic_get(&ctx->running)) {
+        // host tools are polled, so wake at least once per poll period
+        uint32_t ready = 0;
+        zros_waitset_wait(&ctx->waitset, K_MSEC(CONFIG_CEREBRI_SYNAPSE_SHM_POLL_MS), &ready);
+
+        for (size_t i = 0; i < ctx->tx_count; i++) {
+            if (ready & BIT(i)) {
+                write_topic(ctx, &ctx->subs[i], ctx->tx_index[i]);
+            }
+        }
+
+        for (size_t i = 0; i < ARRAY_SIZE(g_rx_topics); i++) {
+            read_topic(ctx, i);
+        }
+    }
+
+    fini(ctx);
+}
+
+static int start()
+{
+    atomic_set(&g_ctx.running, 1);
+    k_tid_t tid = k_thread_create(&g_my_thread_data, g_my_stack_area,
+        K_THREAD_STACK_SIZEOF(g_my_stack_area),
+        run,
+        &g_ctx, NULL, NULL,
+        MY_PRIORITY, 0, K_FOREVER);
+    k_thread_name_set(tid, "syn_shm");
+    k_thread_start(tid);
+    return 0;
+}
+
+static int cmd_start(const struct shell* sh,
+    size_t argc, char** argv, void* data)
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+    ARG_UNUSED(data);
+
+    if (atomic_get(&g_ctx.running)) {
+        shell_print(sh, "already running");
+    } else {
+        start();
+    }
+    return 0;
+}
+
+static int cmd_stop(const struct shell* sh,
+    size_t argc, char** argv, void* data)
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+    ARG_UNUSED(data);
+
+    if (atomic_get(&g_ctx.running)) {
+        atomic_set(&g_ctx.running, 0);
+    } else {
+        shell_print(sh, "not running");
+    }
+    return 0;
+}
+
+static int cmd_status(const struct shell* sh,
+    size_t argc, char** argv, void* data)
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+    ARG_UNUSED(data);
+
+    shell_print(sh, "running: %d", (int)atomic_get(&g_ctx.running));
+    shell_print(sh, "segment: %s (%u bytes)", CONFIG_CEREBRI_SYNAPSE_SHM_NAME, g_ctx.size);
+    shell_print(sh, "written: %u", g_ctx.written);
+    shell_print(sh, "read: %u", g_ctx.read);
+    shell_print(sh, "busy: %u", g_ctx.busy);
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_syn_shm,
+    SHELL_CMD(start, NULL, "start", cmd_start),
+    SHELL_CMD(stop, NULL, "stop", cmd_stop),
+    SHELL_CMD(status, NULL, "status", cmd_status),
+    SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(syn_shm, &sub_syn_shm, "syn shared memory commands", NULL);
+
+SYS_INIT(start, APPLICATION, 0);
+
+// vi: ts=4 sw=4 et
@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2024 CogniPilot Foundation
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "shm_bottom.h"
+
+int synapse_shm_bottom_open(const char* name, uint32_t size, void** base)
+{
+    int fd = shm_open(name, O_CREAT | O_RDWR, 0600);
+    if (fd < 0) {
+        return -errno;
+    }
+    if (ftruncate(fd, size) < 0) {
+        int err = errno;
+        close(fd);
+        return -err;
+    }
+    void* addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        return -errno;
+    }
+    // a segment left by an earlier run keeps its contents
+    memset(addr, 0, size);
+    *base = addr;
+    return 0;
+}
+
+int synapse_shm_bottom_close(const char* name, uint32_t size, void* base)
+{
+    int ret = 0;
+    if (munmap(base, size) < 0) {
+        ret = -errno;
+    }
+    shm_unlink(name);
+    return ret;
+}
+
+// vi: ts=4 sw=4 et
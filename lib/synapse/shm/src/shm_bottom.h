@@ -0,0 +1,15 @@
+/*
+ * Copyright (c) 2024 CogniPilot Foundation
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef SYNAPSE_SHM_BOTTOM_H
+#define SYNAPSE_SHM_BOTTOM_H
+
+#include <stdint.h>
+
+// host side of the shared memory transport, returns 0 or -errno
+int synapse_shm_bottom_open(const char* name, uint32_t size, void** base);
+int synapse_shm_bottom_close(const char* name, uint32_t size, void* base);
+
+#endif // SYNAPSE_SHM_BOTTOM_H
+// vi: ts=4 sw=4 et
@@ -19,6 +19,7 @@ int snprint_ledarray(char* buf, size_t n, synapse_msgs_LEDArray* m);
 int snprint_point(char* buf, size_t n, synapse_msgs_Point* m);
 int snprint_pose(char* buf, size_t n, synapse_msgs_Pose* m);
 int snprint_pose_with_covariance(char* buf, size_t n, synapse_msgs_PoseWithCovariance* m);
+int snprint_road_curve_angle(char* buf, size_t n, synapse_msgs_RoadCurveAngle* m);
 int snprint_quaternion(char* buf, size_t n, synapse_msgs_Quaternion* m);
 int snprint_status(char* buf, size_t n, synapse_msgs_Status* m);
 int snprint_time(char* buf, size_t n, synapse_msgs_Time* m);
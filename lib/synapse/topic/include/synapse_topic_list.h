@@ -30,6 +30,7 @@ void stamp_header(synapse_msgs_Header* hdr, int64_t ticks);
 const char* mode_str(synapse_msgs_Status_Mode mode);
 const char* armed_str(synapse_msgs_Status_Arming arming);
 const char* status_joy_str(synapse_msgs_Status_Joy joy);
+struct zros_topic* synapse_topic_from_tf_type(int type);
 
 enum {
     JOY_BUTTON_MANUAL = 0,
@@ -142,6 +142,11 @@ int snprint_ledarray(char* buf, size_t n, synapse_msgs_LEDArray* m)
     return offset;
 }
 
+int snprint_road_curve_angle(char* buf, size_t n, synapse_msgs_RoadCurveAngle* m)
+{
+    return snprintf_cat(buf, n, "angle: %10.4f\n", m->angle);
+}
+
 int snprint_point(char* buf, size_t n, synapse_msgs_Point* m)
 {
     return snprintf_cat(buf, 100, "x: %10.4f y: %10.4f z: %10.4f\n", m->x, m->y, m->z);
@@ -12,24 +12,34 @@
 #include <zros/private/zros_pub_struct.h>
 #include <zros/private/zros_sub_struct.h>
 #include <zros/private/zros_topic_struct.h>
+#include <zros/private/zros_waitset_struct.h>
 #include <zros/zros_broker.h>
 #include <zros/zros_common.h>
+#include <zros/zros_latency.h>
 #include <zros/zros_node.h>
 #include <zros/zros_pub.h>
 #include <zros/zros_sub.h>
 #include <zros/zros_topic.h>
+#include <zros/zros_waitset.h>
+
+#ifdef CONFIG_CEREBRI_CORE_CLOCK
+#include <cerebri/core/clock.h>
+#endif
 
 LOG_MODULE_REGISTER(zros_topic);
 
 #include "synapse_shell_print.h"
 #include "synapse_topic_list.h"
 
-#define TOPIC_DICTIONARY()                                                     \
-    (actuators, &topic_actuators, "actuators"),                                \
-    (imu, &topic_imu, "imu"),                                                  \
-    (joy, &topic_joy, "joy"),                                                  \
-    (led_array, &topic_led_array, "led_array"),                                \
-    (status, &topic_status, "status")
+// topic argument of a command, resolved through the registry
+static struct zros_topic* topic_arg(const struct shell* sh, const char* name)
+{
+    struct zros_topic* topic = zros_broker_find_topic(name);
+    if (topic == NULL) {
+        shell_error(sh, "unknown topic: %s", name);
+    }
+    return topic;
+}
 
 int topic_count_hz(const struct shell* sh, struct zros_topic* topic, void* msg, snprint_t* echo)
 {
@@ -37,9 +47,9 @@ int topic_count_hz(const struct shell* sh, struct zros_topic* topic, void* msg,
     struct zros_node node;
     zros_node_init(&node, "sub hz");
     zros_sub_init(&sub, &node, topic, msg, 1000);
-    struct k_poll_event events[1] = {
-        *zros_sub_get_event(&sub),
-    };
+    struct zros_waitset waitset;
+    zros_waitset_init(&waitset, NULL);
+    zros_waitset_add(&waitset, &sub);
 
     int64_t ticks_start = k_uptime_ticks();
     int64_t elapsed_ticks = 0;
@@ -53,9 +63,8 @@ int topic_count_hz(const struct shell* sh, struct zros_topic* topic, void* msg,
     int msg_count = 0;
 
     while (ticks_remaining > 0.1 * CONFIG_SYS_CLOCK_TICKS_PER_SEC && msg_count < max_msg) {
-        int rc = 0;
-        rc = k_poll(events, ARRAY_SIZE(events),
-            K_MSEC(1e3 * ticks_remaining / CONFIG_SYS_CLOCK_TICKS_PER_SEC));
+        uint32_t ready = 0;
+        int rc = zros_waitset_wait(&waitset, K_TICKS(ticks_remaining), &ready);
         if (rc != 0) {
             char name[20];
             zros_topic_get_name(topic, name, sizeof(name));
@@ -65,7 +74,7 @@ int topic_count_hz(const struct shell* sh, struct zros_topic* topic, void* msg,
         elapsed_ticks = k_uptime_ticks() - ticks_start;
         ticks_remaining = ticks_sample - elapsed_ticks;
 
-        if (zros_sub_update_available(&sub)) {
+        if (ready) {
             rc = zros_sub_update(&sub);
             if (rc == 0) {
                 msg_tick[msg_count] = k_uptime_ticks();
@@ -121,70 +130,64 @@ int topic_echo(const struct shell* sh, struct zros_topic* topic, void* msg, snpr
     zros_node_init(&node, "sub hz");
     zros_sub_init(&sub, &node, topic, msg, 1000);
     char name[20] = {};
-    struct k_poll_event events[1] = {
-        *zros_sub_get_event(&sub),
-    };
+    struct zros_waitset waitset;
+    zros_waitset_init(&waitset, NULL);
+    zros_waitset_add(&waitset, &sub);
     float sample_period = 2.0;
-    int rc = 0;
-    rc = k_poll(events, ARRAY_SIZE(events), K_MSEC(sample_period * 1e3));
+    uint32_t ready = 0;
+    int rc = zros_waitset_wait(&waitset, K_MSEC(sample_period * 1e3), &ready);
     zros_topic_get_name(topic, name, sizeof(name));
     if (rc != 0) {
         LOG_WRN("%s not published.", name);
-        return -1;
+        rc = -1;
     } else {
-        if (!zros_sub_update_available(&sub)) {
-            LOG_WRN("%s no update available.", name);
-            return -1;
-        } else {
-            zros_sub_update(&sub);
-            echo(buf, sizeof(buf), msg);
-            printf("%s", buf);
-            memset(buf, 0, sizeof(buf));
-        }
+        zros_sub_update(&sub);
+        echo(buf, sizeof(buf), msg);
+        printf("%s", buf);
+        memset(buf, 0, sizeof(buf));
+        rc = ZROS_OK;
     }
     zros_sub_fini(&sub);
     zros_node_fini(&node);
-    return ZROS_OK;
+    return rc;
 }
 
 typedef int msg_handler_t(const struct shell* sh, struct zros_topic* topic, void* msg, snprint_t* echo);
 
 int handle_msg(const struct shell* sh, struct zros_topic* topic, msg_handler_t* handler)
 {
-    if (topic == &topic_actuators) {
-        synapse_msgs_Actuators msg = {};
-        return handler(sh, topic, &msg, (snprint_t*)&snprint_actuators);
-    } else if (topic == &topic_status) {
-        synapse_msgs_Status msg = {};
-        return handler(sh, topic, &msg, (snprint_t*)&snprint_status);
-    } else if (topic == &topic_imu) {
-        synapse_msgs_Imu msg = {};
-        return handler(sh, topic, &msg, (snprint_t*)&snprint_imu);
-    } else if (topic == &topic_joy) {
-        synapse_msgs_Joy msg = {};
-        return handler(sh, topic, &msg, (snprint_t*)&snprint_joy);
-    } else if (topic == &topic_led_array) {
-        synapse_msgs_LEDArray msg = {};
-        return handler(sh, topic, &msg, (snprint_t*)&snprint_ledarray);
-    } else {
-        char name[20];
-        zros_topic_get_name(topic, name, sizeof(name));
+    // shell commands run one at a time, so one buffer serves every topic
+    static uint8_t msg[2048] __aligned(8);
+    char name[20];
+    zros_topic_get_name(topic, name, sizeof(name));
+    if (topic->_snprint == NULL) {
         shell_print(sh, "%s not handled", name);
+        return ZROS_OK;
+    } else if (topic->_size > (int)sizeof(msg)) {
+        shell_print(sh, "%s too large: %d bytes", name, topic->_size);
+        return -ENOMEM;
     }
-    return ZROS_OK;
+    memset(msg, 0, topic->_size);
+    return handler(sh, topic, msg, topic->_snprint);
 }
 
 static int cmd_zros_topic_hz(const struct shell* sh,
-    size_t argc, char** argv, void* data)
+    size_t argc, char** argv)
 {
-    struct zros_topic* topic = (struct zros_topic*)data;
+    struct zros_topic* topic = topic_arg(sh, argv[1]);
+    if (topic == NULL) {
+        return -EINVAL;
+    }
     return handle_msg(sh, topic, &topic_count_hz);
 }
 
 static int cmd_zros_topic_echo(const struct shell* sh,
-    size_t argc, char** argv, void* data)
+    size_t argc, char** argv)
 {
-    struct zros_topic* topic = (struct zros_topic*)data;
+    struct zros_topic* topic = topic_arg(sh, argv[1]);
+    if (topic == NULL) {
+        return -EINVAL;
+    }
     return handle_msg(sh, topic, &topic_echo);
 }
 
@@ -203,6 +206,122 @@ static int cmd_zros_topic_list(const struct shell* sh,
     return ZROS_OK;
 }
 
+#define TOPIC_STATS_MAX 32
+
+struct topic_stats_sample {
+    int n;
+    const struct zros_topic* topic[TOPIC_STATS_MAX];
+    atomic_val_t published[TOPIC_STATS_MAX];
+};
+
+static const char* topic_mode_str(enum zros_topic_mode mode)
+{
+    if (mode == ZROS_TOPIC_MODE_LOCK) {
+        return "lock";
+    } else if (mode == ZROS_TOPIC_MODE_SEQLOCK) {
+        return "seqlock";
+    } else if (mode == ZROS_TOPIC_MODE_LOAN) {
+        return "loan";
+    }
+    return "unknown";
+}
+
+void topic_stats_sample_iterator(const struct zros_topic* topic, void* data)
+{
+    struct topic_stats_sample* sample = (struct topic_stats_sample*)data;
+    if (sample->n < TOPIC_STATS_MAX) {
+        sample->topic[sample->n] = topic;
+        sample->published[sample->n] = atomic_get(&topic->_published);
+        sample->n++;
+    }
+}
+
+#define SUB_STATS_MAX 16
+
+// subscriber counters, copied under the topic list lock and printed after,
+// so a slow shell never holds up a publish
+struct sub_stats_sample {
+    int n;
+    struct {
+        const struct zros_node* node;
+        uint32_t signals;
+        uint32_t skips;
+        uint32_t reads;
+        uint32_t lock_timeouts;
+        uint32_t lost;
+    } sub[SUB_STATS_MAX];
+};
+
+void sub_stats_sample_iterator(const struct zros_sub* sub, void* data)
+{
+    struct sub_stats_sample* sample = (struct sub_stats_sample*)data;
+    if (sample->n < SUB_STATS_MAX) {
+        sample->sub[sample->n].node = sub->_node;
+        sample->sub[sample->n].signals = sub->_signals;
+        sample->sub[sample->n].skips = sub->_skips;
+        sample->sub[sample->n].reads = sub->_reads;
+        sample->sub[sample->n].lock_timeouts = sub->_lock_timeouts;
+        sample->sub[sample->n].lost = sub->_lost;
+        sample->n++;
+    }
+}
+
+// counters of every topic and its subscribers, the rate is the publish count
+// difference over a one second window, so no subscription is needed
+static int cmd_zros_topic_stats(const struct shell* sh,
+    size_t argc, char** argv)
+{
+    static struct topic_stats_sample start;
+    static struct topic_stats_sample end;
+    start.n = 0;
+    end.n = 0;
+    zros_broker_iterate_topic(topic_stats_sample_iterator, &start);
+    int64_t ticks = k_uptime_ticks();
+    k_msleep(1000);
+    zros_broker_iterate_topic(topic_stats_sample_iterator, &end);
+    ticks = k_uptime_ticks() - ticks;
+
+    for (int i = 0; i < end.n; i++) {
+        struct zros_topic* topic = (struct zros_topic*)end.topic[i];
+        atomic_val_t published_start = end.published[i];
+        for (int j = 0; j < start.n; j++) {
+            if (start.topic[j] == topic) {
+                published_start = start.published[j];
+            }
+        }
+        double hz = (double)(end.published[i] - published_start) * CONFIG_SYS_CLOCK_TICKS_PER_SEC / ticks;
+        // publish times are on the cerebri clock when there is one
+#ifdef CONFIG_CEREBRI_CORE_CLOCK
+        int64_t now = core_clock_ticks();
+#else
+        int64_t now = k_uptime_ticks();
+#endif
+        int64_t last = topic->_last_publish_ticks;
+        char last_str[20] = "never";
+        if (last != 0) {
+            snprintf(last_str, sizeof(last_str), "%lld ms ago",
+                (long long)k_ticks_to_ms_floor64(now - last));
+        }
+        char name[30];
+        zros_topic_get_name(topic, name, sizeof(name));
+        shell_print(sh, "%-20s %-7s published: %8ld rate: %8.2f Hz bytes: %10llu timeouts: %ld last: %s",
+            name, topic_mode_str(topic->_mode), end.published[i], hz,
+            (unsigned long long)end.published[i] * topic->_size,
+            atomic_get(&topic->_lock_timeouts), last_str);
+        static struct sub_stats_sample subs;
+        subs.n = 0;
+        zros_topic_iterate_sub(topic, sub_stats_sample_iterator, &subs);
+        for (int j = 0; j < subs.n; j++) {
+            zros_node_get_name(subs.sub[j].node, name, sizeof(name));
+            shell_print(sh, "\t%-20s signals: %8u skips: %8u reads: %8u bytes: %10llu timeouts: %u lost: %u",
+                name, subs.sub[j].signals, subs.sub[j].skips, subs.sub[j].reads,
+                (unsigned long long)subs.sub[j].reads * topic->_size,
+                subs.sub[j].lock_timeouts, subs.sub[j].lost);
+        }
+    }
+    return ZROS_OK;
+}
+
 void pub_print_iterator(const struct zros_pub* pub, void* data)
 {
     const struct shell* sh = (const struct shell*)data;
@@ -220,9 +339,12 @@ void sub_print_iterator(const struct zros_sub* sub, void* data)
 }
 
 static int cmd_zros_topic_info(const struct shell* sh,
-    size_t argc, char** argv, void* data)
+    size_t argc, char** argv)
 {
-    struct zros_topic* topic = (struct zros_topic*)data;
+    struct zros_topic* topic = topic_arg(sh, argv[1]);
+    if (topic == NULL) {
+        return -EINVAL;
+    }
     shell_print(sh, "pubs");
     zros_topic_iterate_pub(topic, pub_print_iterator, (void*)sh);
     shell_print(sh, "subs");
@@ -230,6 +352,67 @@ static int cmd_zros_topic_info(const struct shell* sh,
     return ZROS_OK;
 }
 
+#ifdef CONFIG_CEREBRI_SYNAPSE_ZROS_LATENCY
+static void latency_print(const struct shell* sh, const char* label, const struct zros_latency* latency)
+{
+    shell_print(sh, "\t  %-10s n: %8u  min: %8u us  mean: %8u us  max: %8u us", label,
+        latency->count, latency->min_us, zros_latency_mean_us(latency), latency->max_us);
+    char buf[200];
+    int len = 0;
+    for (int i = 0; i < ZROS_LATENCY_BINS && len < (int)sizeof(buf); i++) {
+        if (latency->hist[i] > 0) {
+            len += snprintf(buf + len, sizeof(buf) - len, " >=%uus:%u",
+                zros_latency_bin_us(i), latency->hist[i]);
+        }
+    }
+    if (len > 0) {
+        shell_print(sh, "\t  %-10s%s", "", buf);
+    }
+}
+
+struct sub_latency_sample {
+    int n;
+    struct {
+        const struct zros_node* node;
+        struct zros_latency delivery;
+        struct zros_latency end_to_end;
+    } sub[SUB_STATS_MAX];
+};
+
+void sub_latency_sample_iterator(const struct zros_sub* sub, void* data)
+{
+    struct sub_latency_sample* sample = (struct sub_latency_sample*)data;
+    if (sample->n < SUB_STATS_MAX) {
+        sample->sub[sample->n].node = sub->_node;
+        sample->sub[sample->n].delivery = sub->_delivery;
+        sample->sub[sample->n].end_to_end = sub->_end_to_end;
+        sample->n++;
+    }
+}
+
+static int cmd_zros_topic_latency(const struct shell* sh,
+    size_t argc, char** argv)
+{
+    struct zros_topic* topic = topic_arg(sh, argv[1]);
+    if (topic == NULL) {
+        return -EINVAL;
+    }
+    // copied under the topic list lock, printed after
+    static struct sub_latency_sample subs;
+    subs.n = 0;
+    zros_topic_iterate_sub(topic, sub_latency_sample_iterator, &subs);
+    shell_print(sh, "subs");
+    for (int i = 0; i < subs.n; i++) {
+        char name[30];
+        zros_node_get_name(subs.sub[i].node, name, sizeof(name));
+        shell_print(sh, "\t%s", name);
+        latency_print(sh, "delivery", &subs.sub[i].delivery);
+        latency_print(sh, "end2end", &subs.sub[i].end_to_end);
+    }
+    return ZROS_OK;
+}
+#endif
+
 void node_print_iterator(const struct zros_node* node, void* data)
 {
     const struct shell* sh = (const struct shell*)data;
@@ -245,16 +428,27 @@ static int cmd_zros_node_list(const struct shell* sh,
     return ZROS_OK;
 }
 
-// level 2 (topic echo/hz/list)
-SHELL_SUBCMD_DICT_SET_CREATE(sub_zros_topic_echo, cmd_zros_topic_echo, TOPIC_DICTIONARY());
-SHELL_SUBCMD_DICT_SET_CREATE(sub_zros_topic_hz, cmd_zros_topic_hz, TOPIC_DICTIONARY());
-SHELL_SUBCMD_DICT_SET_CREATE(sub_zros_topic_info, cmd_zros_topic_info, TOPIC_DICTIONARY());
+// level 3 (topic names, completed from the registry)
+static void topic_name_get(size_t idx, struct shell_static_entry* entry)
+{
+    struct zros_topic* topic = zros_broker_get_topic(idx);
+    entry->syntax = topic != NULL ? topic->_name : NULL;
+    entry->handler = NULL;
+    entry->help = NULL;
+    entry->subcmd = NULL;
+}
 
+SHELL_DYNAMIC_CMD_CREATE(sub_zros_topic_name, topic_name_get);
+
+// level 2 (topic echo/hz/list)
 SHELL_STATIC_SUBCMD_SET_CREATE(sub_zros_topic,
-    SHELL_CMD(echo, &sub_zros_topic_echo, "Echo topic.", NULL),
-    SHELL_CMD(hz, &sub_zros_topic_hz, "Check topic pub rate.", NULL),
-    SHELL_CMD(info, &sub_zros_topic_info, "Topic pubs and subs.", NULL),
+    SHELL_CMD_ARG(echo, &sub_zros_topic_name, "Echo topic.", cmd_zros_topic_echo, 2, 0),
+    SHELL_CMD_ARG(hz, &sub_zros_topic_name, "Check topic pub rate.", cmd_zros_topic_hz, 2, 0),
+    SHELL_CMD_ARG(info, &sub_zros_topic_name, "Topic pubs and subs.", cmd_zros_topic_info, 2, 0),
+    SHELL_COND_CMD_ARG(CONFIG_CEREBRI_SYNAPSE_ZROS_LATENCY, latency, &sub_zros_topic_name,
+        "Subscriber latency.", cmd_zros_topic_latency, 2, 0),
     SHELL_CMD(list, NULL, "List topics.", cmd_zros_topic_list),
+    SHELL_CMD(stats, NULL, "Counters of all topics.", cmd_zros_topic_stats),
     SHELL_SUBCMD_SET_END);
 
 // level 2 (node list)
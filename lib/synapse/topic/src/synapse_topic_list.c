@@ -4,12 +4,14 @@
  */
 
 #include <zephyr/init.h>
-#include <zephyr/sys/slist.h>
+#include <zephyr/sys/util.h>
 
-#include <zros/private/zros_broker_struct.h>
 #include <zros/private/zros_topic_struct.h>
 #include <zros/zros_broker.h>
 
+#include <synapse_tinyframe/SynapseTopics.h>
+
+#include "synapse_shell_print.h"
 #include "synapse_topic_list.h"
 
 //*******************************************************************
@@ -67,36 +69,49 @@ const char* status_joy_str(synapse_msgs_Status_Joy joy)
 /********************************************************************
  * topics
  ********************************************************************/
-ZROS_TOPIC_DEFINE(actuators_manual, synapse_msgs_Actuators);
-ZROS_TOPIC_DEFINE(actuators_auto, synapse_msgs_Actuators);
-ZROS_TOPIC_DEFINE(actuators, synapse_msgs_Actuators);
-
-ZROS_TOPIC_DEFINE(status, synapse_msgs_Status);
-ZROS_TOPIC_DEFINE(road_curve_angle, synapse_msgs_RoadCurveAngle);
-ZROS_TOPIC_DEFINE(imu, synapse_msgs_Imu);
-ZROS_TOPIC_DEFINE(joy, synapse_msgs_Joy);
-ZROS_TOPIC_DEFINE(led_array, synapse_msgs_LEDArray);
-
-static struct zros_topic* topic_list[] = {
-    &topic_actuators_manual,
-    &topic_actuators_auto,
-    &topic_actuators,
-
-    &topic_status,
-    &topic_road_curve_angle,
-    &topic_imu,
-    &topic_joy,
-    &topic_led_array,
-};
-
-static int set_topic_list()
+ZROS_TOPIC_DEFINE_MSG(actuators_manual, synapse_msgs_Actuators, ZROS_TOPIC_MODE_SEQLOCK,
+    -1, snprint_actuators);
+ZROS_TOPIC_DEFINE_MSG(actuators_auto, synapse_msgs_Actuators, ZROS_TOPIC_MODE_SEQLOCK,
+    -1, snprint_actuators);
+ZROS_TOPIC_DEFINE_MSG(actuators, synapse_msgs_Actuators, ZROS_TOPIC_MODE_SEQLOCK,
+    SYNAPSE_ACTUATORS_TOPIC, snprint_actuators);
+
+ZROS_TOPIC_DEFINE_MSG(status, synapse_msgs_Status, ZROS_TOPIC_MODE_LOAN,
+    SYNAPSE_STATUS_TOPIC, snprint_status);
+// written by syn_eth_rx, which decodes straight into a loaned buffer
+ZROS_TOPIC_DEFINE_MSG(road_curve_angle, synapse_msgs_RoadCurveAngle, ZROS_TOPIC_MODE_LOAN,
+    SYNAPSE_ROAD_CURVE_ANGLE_TOPIC, snprint_road_curve_angle);
+// imu keeps 80 ms of samples at 200 Hz so slow consumers can drain every one
+ZROS_TOPIC_DEFINE_MSG_HISTORY(imu, synapse_msgs_Imu, ZROS_TOPIC_MODE_SEQLOCK, 16,
+    SYNAPSE_IMU_TOPIC, snprint_imu);
+ZROS_TOPIC_DEFINE_MSG(joy, synapse_msgs_Joy, ZROS_TOPIC_MODE_LOAN,
+    SYNAPSE_JOY_TOPIC, snprint_joy);
+ZROS_TOPIC_DEFINE_MSG(led_array, synapse_msgs_LEDArray, ZROS_TOPIC_MODE_LOAN,
+    SYNAPSE_LED_ARRAY_TOPIC, snprint_ledarray);
+
+// registry index + 1 of the topic bridged as each tinyframe type, 0 if none
+static uint8_t g_tf_index[256];
+
+struct zros_topic* synapse_topic_from_tf_type(int type)
+{
+    if (type < 0 || type >= (int)ARRAY_SIZE(g_tf_index) || g_tf_index[type] == 0) {
+        return NULL;
+    }
+    return zros_broker_get_topic(g_tf_index[type] - 1);
+}
+
+static int synapse_topic_tf_init(void)
 {
-    for (size_t i = 0; i < ARRAY_SIZE(topic_list); i++) {
-        zros_broker_add_topic(topic_list[i]);
+    for (size_t i = 0; i < zros_broker_topic_count(); i++) {
+        const struct zros_topic* topic = zros_broker_get_topic(i);
+        if (topic->_tf_type >= 0 && topic->_tf_type < (int)ARRAY_SIZE(g_tf_index)) {
+            g_tf_index[topic->_tf_type] = i + 1;
+        }
     }
     return 0;
 }
 
-SYS_INIT(set_topic_list, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+// before the bridges start at the application level
+SYS_INIT(synapse_topic_tf_init, POST_KERNEL, 0);
 
 // vi: ts=4 sw=4 et
@@ -15,7 +15,6 @@ struct zros_topic;
 struct zros_broker {
     struct k_mutex _lock;
     sys_slist_t _nodes; // list of nodes
-    sys_slist_t _topics; // list of topics
 };
 
 #endif // ZROS_BROKER_STRUCT_H
@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2024 CogniPilot Foundation
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef ZROS_EXECUTOR_STRUCT_H
+#define ZROS_EXECUTOR_STRUCT_H
+
+#include <zephyr/kernel.h>
+
+#ifdef CONFIG_CEREBRI_CORE_CLOCK
+#include <cerebri/core/clock.h>
+#endif
+
+#ifdef CONFIG_CEREBRI_CORE_WORKQUEUES
+#include <cerebri/core/workq.h>
+#endif
+
+#include <zros/private/zros_waitset_struct.h>
+#include <zros/zros_executor.h>
+
+/********************************************************************
+ * zros_executor struct
+ ********************************************************************/
+struct zros_executor {
+#ifdef CONFIG_CEREBRI_CORE_WORKQUEUES
+    struct core_work _work; // bound to the queue, in the workq statistics
+#else
+    struct k_work _work;
+    struct k_work_q* _queue;
+#endif
+    struct zros_waitset _waitset; // subscriptions, only taken, never polled
+    zros_executor_callback_t* _callback;
+    void* _user_data;
+#ifdef CONFIG_CEREBRI_CORE_CLOCK
+    struct core_clock_timer _timer;
+#else
+    struct k_timer _timer;
+#endif
+    uint32_t _runs; // callbacks run
+    uint32_t _idle_runs; // runs with no subscription signalled
+};
+
+#endif // ZROS_EXECUTOR_STRUCT_H
+// vi: ts=4 sw=4 et
@@ -0,0 +1,25 @@
+/*
+ * Copyright (c) 2023 CogniPilot Foundation
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef ZROS_LATENCY_STRUCT_H
+#define ZROS_LATENCY_STRUCT_H
+
+#include <zephyr/kernel.h>
+
+// bin 0 holds 0 us, bin i holds [2^(i-1), 2^i) us, the last bin the rest
+#define ZROS_LATENCY_BINS 16
+
+/********************************************************************
+ * zros latency
+ ********************************************************************/
+struct zros_latency {
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint64_t sum_us;
+    uint32_t hist[ZROS_LATENCY_BINS];
+};
+
+#endif // ZROS_LATENCY_STRUCT_H
+// vi: ts=4 sw=4 et
@@ -16,6 +16,9 @@ struct zros_node {
     sys_slist_t _subs; // list of subscriptions
     sys_slist_t _pubs; // list of publications
     struct k_mutex _lock;
+#ifdef CONFIG_CEREBRI_SYNAPSE_ZROS_LATENCY
+    uint32_t _origin_cycles; // origin of the newest data read, 0 if none
+#endif
 };
 
 #endif // ZROS_NODE_STRUCT_H
@@ -16,6 +16,7 @@ struct zros_pub {
     struct zros_topic* _topic;
     void* _data;
     struct zros_node* _node;
+    int _loan; // loaned topic buffer, -1 if none
 };
 
 // vi: ts=4 sw=4 et
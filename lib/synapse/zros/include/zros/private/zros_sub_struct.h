@@ -7,11 +7,16 @@
 
 #include <zephyr/kernel.h>
 
+#ifdef CONFIG_CEREBRI_SYNAPSE_ZROS_LATENCY
+#include <zros/private/zros_latency_struct.h>
+#endif
+
 /********************************************************************
  * zros_sub struct
  ********************************************************************/
 struct zros_topic;
 struct zros_node;
+struct zros_executor;
 
 struct zros_sub {
     sys_snode_t _topic_list_node;
@@ -20,9 +25,23 @@ struct zros_sub {
     void* _data;
     struct k_poll_signal _data_ready;
     double _rate_limit_hz;
+    int64_t _min_interval_ticks; // ticks between signals allowed by the rate limit
     int64_t _last_update_ticks;
     struct k_poll_event _event;
+    struct zros_executor* _executor; // triggered on a signal, NULL if none
     struct zros_node* _node;
+    int _borrow; // borrowed topic buffer, -1 if none
+    atomic_val_t _cursor; // number of the last message drained from history
+    uint32_t _lost; // history messages overwritten before they were drained
+    uint32_t _signals; // publishes signalled to the subscriber
+    uint32_t _skips; // publishes skipped by the rate limit
+    uint32_t _reads; // successful updates
+    uint32_t _lock_timeouts; // updates failed on the topic lock
+#ifdef CONFIG_CEREBRI_SYNAPSE_ZROS_LATENCY
+    atomic_val_t _traced; // number of the last message traced
+    struct zros_latency _delivery; // publish to read
+    struct zros_latency _end_to_end; // origin to read
+#endif
 };
 
 #endif // ZROS_SUB_STRUCT_H
@@ -7,18 +7,39 @@
 
 #include <zephyr/kernel.h>
 
+#include <zros/zros_topic.h>
+
 /********************************************************************
  * zros topic
  ********************************************************************/
+struct pb_msgdesc_s;
+
 struct zros_topic {
     const char* _name;
-    sys_snode_t _broker_list_node;
     void* _data; // data pointer for subscriber pull
     int _size; // size of data
     sys_slist_t _subs; // list of subscriptions
     sys_slist_t _pubs; // list of publications
     struct k_sem _sem_read; // read semaphore
     struct k_mutex _lock_write; // write mutex
+    enum zros_topic_mode _mode; // synchronization mode
+    atomic_t _seq; // seqlock sequence, odd while a write is in progress
+    atomic_t* _refs; // loan: borrow count of each buffer
+    atomic_t _latest; // loan: index of the last committed buffer
+    atomic_t _published; // number of the last message published
+    void* _history; // ring of the last messages, NULL if none
+    atomic_t* _history_seq; // message number held by each ring entry, 0 while written
+    int _history_depth; // number of ring entries
+    atomic_t _lock_timeouts; // failed lock attempts
+    int64_t _last_publish_ticks; // clock ticks of the last publish
+    const struct pb_msgdesc_s* _fields; // nanopb message descriptor, NULL if none
+    size_t _encoded_size; // largest encoding of the message, 0 if unknown
+    int _tf_type; // tinyframe type, -1 if not bridged
+    zros_snprint_t* _snprint; // message printer, NULL if none
+#ifdef CONFIG_CEREBRI_SYNAPSE_ZROS_LATENCY
+    uint32_t _publish_cycles; // cycle count of the last publish
+    uint32_t _origin_cycles; // cycle count the data of the last publish originated
+#endif
 };
 
 // vi: ts=4 sw=4 et
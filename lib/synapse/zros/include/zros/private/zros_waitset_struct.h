@@ -0,0 +1,27 @@
+/*
+ * Copyright (c) 2024 CogniPilot Foundation
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef ZROS_WAITSET_STRUCT_H
+#define ZROS_WAITSET_STRUCT_H
+
+#include <zephyr/kernel.h>
+
+#include <zros/zros_waitset.h>
+
+/********************************************************************
+ * zros_waitset struct
+ ********************************************************************/
+struct zros_sub;
+
+struct zros_waitset {
+    struct k_poll_event _events[CONFIG_CEREBRI_SYNAPSE_ZROS_WAITSET_SIZE];
+    struct zros_sub* _subs[CONFIG_CEREBRI_SYNAPSE_ZROS_WAITSET_SIZE];
+    int _count;
+    zros_waitset_poll_t* _poll;
+    uint32_t _polls; // waits that had to block
+    uint32_t _wakeups; // waits that returned updates
+};
+
+#endif // ZROS_WAITSET_STRUCT_H
+// vi: ts=4 sw=4 et
@@ -21,11 +21,12 @@ int zros_broker_add_node(struct zros_node* node);
 int zros_broker_remove_node(struct zros_node* node);
 int zros_broker_iterate_nodes(zros_node_iterator_t* iter, void* data);
 
-// public topic api
+// public topic api, topics are registered at compile time by ZROS_TOPIC_DEFINE
 typedef void zros_topic_iterator_t(const struct zros_topic* topic, void* data);
-int zros_broker_add_topic(struct zros_topic* topic);
-int zros_broker_remove_topic(struct zros_topic* topic);
 int zros_broker_iterate_topic(zros_topic_iterator_t* iter, void* data);
+size_t zros_broker_topic_count(void);
+struct zros_topic* zros_broker_get_topic(size_t index);
+struct zros_topic* zros_broker_find_topic(const char* name);
 
 #endif // ZROS_broker_H
 // vi: ts=4 sw=4 et
@@ -0,0 +1,29 @@
+/*
+ * Copyright (c) 2024 CogniPilot Foundation
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef ZROS_EXECUTOR_H
+#define ZROS_EXECUTOR_H
+
+#include <zephyr/kernel.h>
+
+/********************************************************************
+ * zros executor
+ ********************************************************************/
+// forward declarations
+struct zros_executor;
+struct zros_sub;
+
+// runs on the executor work queue with the mask of subscriptions signalled
+// since the last run, in the order they were added, 0 for a periodic run
+typedef void zros_executor_callback_t(struct zros_executor* executor, uint32_t ready, void* user_data);
+
+// public api
+void zros_executor_init(struct zros_executor* executor, const char* name,
+    struct k_work_q* queue, zros_executor_callback_t* callback, void* user_data);
+int zros_executor_add(struct zros_executor* executor, struct zros_sub* sub);
+int zros_executor_trigger(struct zros_executor* executor);
+void zros_executor_set_period(struct zros_executor* executor, k_timeout_t period);
+
+#endif // ZROS_EXECUTOR_H
+// vi: ts=4 sw=4 et
@@ -0,0 +1,22 @@
+/*
+ * Copyright (c) 2023 CogniPilot Foundation
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef ZROS_LATENCY_H
+#define ZROS_LATENCY_H
+
+#include <zephyr/kernel.h>
+
+// forward declarations
+struct zros_latency;
+struct zros_sub;
+
+// public api
+void zros_latency_add(struct zros_latency* latency, uint32_t us);
+void zros_latency_reset(struct zros_latency* latency);
+uint32_t zros_latency_mean_us(const struct zros_latency* latency);
+uint32_t zros_latency_bin_us(int bin);
+void zros_latency_trace_sub(struct zros_sub* sub);
+
+#endif // ZROS_LATENCY_H
+// vi: ts=4 sw=4 et
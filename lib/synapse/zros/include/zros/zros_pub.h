@@ -18,6 +18,9 @@ struct zros_node;
 // public api
 int zros_pub_init(struct zros_pub* pub, struct zros_node* node, struct zros_topic* topic, void* data);
 int zros_pub_update(struct zros_pub* pub);
+int zros_pub_loan(struct zros_pub* pub, void** data);
+int zros_pub_commit(struct zros_pub* pub);
+void zros_pub_cancel(struct zros_pub* pub);
 void zros_pub_fini(struct zros_pub* node);
 void zros_pub_get_node(struct zros_pub* pub, struct zros_node** node);
 
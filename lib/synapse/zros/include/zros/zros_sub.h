@@ -20,6 +20,9 @@ struct zros_node;
 int zros_sub_init(struct zros_sub* sub, struct zros_node* node, struct zros_topic* topic, void* data,
     double rate_limit_hz);
 int zros_sub_update(struct zros_sub* sub);
+int zros_sub_borrow(struct zros_sub* sub, const void** data);
+void zros_sub_release(struct zros_sub* sub);
+int zros_sub_drain(struct zros_sub* sub, void* data, int n);
 bool zros_sub_update_available(struct zros_sub* sub);
 struct k_poll_event* zros_sub_get_event(struct zros_sub* sub);
 void zros_sub_fini(struct zros_sub* sub);
@@ -5,25 +5,100 @@
 #ifndef ZROS_TOPIC_H
 #define ZROS_TOPIC_H
 #include <zephyr/kernel.h>
+#include <zephyr/sys/iterable_sections.h>
 
 /********************************************************************
  * zros topic
  ********************************************************************/
 
-#define ZROS_TOPIC_DEFINE(NAME, TYPE)                                 \
-    static TYPE g_msg_##NAME = {};                                    \
-    struct zros_topic topic_##NAME = {                                \
-        ._name = #NAME,                                               \
-        ._data = &g_msg_##NAME,                                       \
-        ._size = sizeof(g_msg_##NAME),                                \
-        ._subs = SYS_SLIST_STATIC_INIT(topic_##NAME._subs),           \
-        ._pubs = SYS_SLIST_STATIC_INIT(topic_##NAME._subs),           \
-        ._broker_list_node = {                                        \
-            .next = NULL,                                             \
-        },                                                            \
-        ._sem_read = Z_SEM_INITIALIZER(topic_##NAME._sem_read, 6, 6), \
-        ._lock_write = Z_MUTEX_INITIALIZER(topic_##NAME._lock_write), \
-    };
+enum zros_topic_mode {
+    // single buffer, readers and writers exclude each other with _sem_read
+    ZROS_TOPIC_MODE_LOCK = 0,
+    // double buffer, writers bump _seq around the copy and readers retry on
+    // a torn read, reads never block and publish does not scale with readers
+    ZROS_TOPIC_MODE_SEQLOCK = 1,
+    // ring of reference counted buffers, publishers can loan a buffer and
+    // subscribers borrow the latest one in place, reads never block
+    ZROS_TOPIC_MODE_LOAN = 2,
+};
+
+// number of message buffers backing a topic in the given mode
+#define ZROS_TOPIC_MODE_BUFFERS(MODE)                     \
+    ((MODE) == ZROS_TOPIC_MODE_SEQLOCK ? 2                \
+        : (MODE) == ZROS_TOPIC_MODE_LOAN                  \
+        ? CONFIG_CEREBRI_SYNAPSE_ZROS_LOAN_SLOTS          \
+        : 1)
+
+// print a message into buf, used by the shell and logger
+typedef int zros_snprint_t(char* buf, size_t n, void* msg);
+
+#define Z_ZROS_TOPIC_INITIALIZER(NAME, TYPE, MODE, HISTORY, HISTORY_SEQ, DEPTH, \
+    FIELDS, ENCODED_SIZE, TF_TYPE, SNPRINT)                            \
+    {                                                                  \
+        ._name = #NAME,                                                \
+        ._data = g_msg_##NAME,                                         \
+        ._size = sizeof(TYPE),                                         \
+        ._subs = SYS_SLIST_STATIC_INIT(topic_##NAME._subs),            \
+        ._pubs = SYS_SLIST_STATIC_INIT(topic_##NAME._pubs),            \
+        ._sem_read = Z_SEM_INITIALIZER(topic_##NAME._sem_read, 6, 6),  \
+        ._lock_write = Z_MUTEX_INITIALIZER(topic_##NAME._lock_write),  \
+        ._mode = MODE,                                                 \
+        ._seq = ATOMIC_INIT(0),                                        \
+        ._refs = g_refs_##NAME,                                        \
+        ._latest = ATOMIC_INIT(0),                                     \
+        ._published = ATOMIC_INIT(0),                                  \
+        ._history = HISTORY,                                           \
+        ._history_seq = HISTORY_SEQ,                                   \
+        ._history_depth = DEPTH,                                       \
+        ._lock_timeouts = ATOMIC_INIT(0),                              \
+        ._last_publish_ticks = 0,                                      \
+        ._fields = FIELDS,                                             \
+        ._encoded_size = ENCODED_SIZE,                                 \
+        ._tf_type = TF_TYPE,                                           \
+        ._snprint = SNPRINT,                                           \
+    }
+
+#define Z_ZROS_TOPIC_BUFFERS(NAME, TYPE, MODE)                    \
+    static TYPE g_msg_##NAME[ZROS_TOPIC_MODE_BUFFERS(MODE)] = {}; \
+    static atomic_t g_refs_##NAME[ZROS_TOPIC_MODE_BUFFERS(MODE)];
+
+#define Z_ZROS_TOPIC_HISTORY_BUFFERS(NAME, TYPE, DEPTH)                       \
+    BUILD_ASSERT((DEPTH) >= 2, "zros topic " #NAME " history depth below 2"); \
+    static TYPE g_history_##NAME[DEPTH];                                      \
+    static atomic_t g_history_seq_##NAME[DEPTH];
+
+#define ZROS_TOPIC_DEFINE(NAME, TYPE, MODE)             \
+    Z_ZROS_TOPIC_BUFFERS(NAME, TYPE, MODE)              \
+    STRUCT_SECTION_ITERABLE(zros_topic, topic_##NAME) = \
+        Z_ZROS_TOPIC_INITIALIZER(NAME, TYPE, MODE, NULL, NULL, 0, NULL, 0, -1, NULL);
+
+// topic that also keeps a ring of DEPTH messages for zros_sub_drain. the
+// entry after the latest may be mid write, so a drain can rely on the last
+// DEPTH - 1 messages only, and DEPTH must be at least 2
+#define ZROS_TOPIC_DEFINE_HISTORY(NAME, TYPE, MODE, DEPTH)                     \
+    Z_ZROS_TOPIC_BUFFERS(NAME, TYPE, MODE)                                     \
+    Z_ZROS_TOPIC_HISTORY_BUFFERS(NAME, TYPE, DEPTH)                            \
+    STRUCT_SECTION_ITERABLE(zros_topic, topic_##NAME) =                        \
+        Z_ZROS_TOPIC_INITIALIZER(NAME, TYPE, MODE, g_history_##NAME,           \
+            g_history_seq_##NAME, DEPTH, NULL, 0, -1, NULL);
+
+// topic of a nanopb message TYPE, with the metadata generic bridges, shell
+// commands and loggers need: TYPE##_fields, TYPE##_size, the tinyframe
+// type, -1 if it is not bridged, and a printer taking a TYPE pointer
+#define ZROS_TOPIC_DEFINE_MSG(NAME, TYPE, MODE, TF_TYPE, SNPRINT)              \
+    Z_ZROS_TOPIC_BUFFERS(NAME, TYPE, MODE)                                     \
+    STRUCT_SECTION_ITERABLE(zros_topic, topic_##NAME) =                        \
+        Z_ZROS_TOPIC_INITIALIZER(NAME, TYPE, MODE, NULL, NULL, 0,              \
+            TYPE##_fields, TYPE##_size, TF_TYPE, (zros_snprint_t*)&SNPRINT);
+
+// message topic with a history ring, see ZROS_TOPIC_DEFINE_HISTORY
+#define ZROS_TOPIC_DEFINE_MSG_HISTORY(NAME, TYPE, MODE, DEPTH, TF_TYPE, SNPRINT) \
+    Z_ZROS_TOPIC_BUFFERS(NAME, TYPE, MODE)                                     \
+    Z_ZROS_TOPIC_HISTORY_BUFFERS(NAME, TYPE, DEPTH)                            \
+    STRUCT_SECTION_ITERABLE(zros_topic, topic_##NAME) =                        \
+        Z_ZROS_TOPIC_INITIALIZER(NAME, TYPE, MODE, g_history_##NAME,           \
+            g_history_seq_##NAME, DEPTH, TYPE##_fields, TYPE##_size, TF_TYPE,  \
+            (zros_snprint_t*)&SNPRINT);
 
 #define ZROS_TOPIC_DECLARE(NAME, TYPE) \
     extern struct zros_topic NAME;
@@ -32,18 +107,29 @@
 struct zros_topic;
 struct zros_sub;
 struct zros_pub;
+struct zros_node;
 
 // public api
 typedef void zros_pub_iterator_t(const struct zros_pub* pub, void* data);
 typedef void zros_sub_iterator_t(const struct zros_sub* sub, void* data);
 int zros_topic_publish(struct zros_topic* topic, void* data);
 int zros_topic_read(struct zros_topic* topic, void* data);
+int zros_topic_loan(struct zros_topic* topic, void** data);
+int zros_topic_commit(struct zros_topic* topic, int slot);
+void zros_topic_cancel(struct zros_topic* topic, int slot);
+int zros_topic_borrow(struct zros_topic* topic, const void** data);
+void zros_topic_release(struct zros_topic* topic, int slot);
+int zros_topic_read_history(struct zros_topic* topic, atomic_val_t* cursor, void* data, int n,
+    uint32_t* lost);
 int zros_topic_get_name(const struct zros_topic* node, char* buf, size_t n);
 int zros_topic_add_pub(struct zros_topic* topic, struct zros_pub* pub);
 int zros_topic_remove_pub(struct zros_topic* topic, struct zros_pub* pub);
 int zros_topic_add_sub(struct zros_topic* topic, struct zros_sub* sub);
 int zros_topic_remove_sub(struct zros_topic* topic, struct zros_sub* sub);
 int zros_topic_iterate_pub(struct zros_topic* topic, zros_pub_iterator_t* iter, void* data);
+// used by zros_pub to pass the publishing node along, may be NULL
+int _zros_topic_publish(struct zros_topic* topic, void* data, const struct zros_node* node);
+int _zros_topic_commit(struct zros_topic* topic, int slot, const struct zros_node* node);
 int zros_topic_iterate_sub(struct zros_topic* topic, zros_sub_iterator_t* iter, void* data);
 
 // vi: ts=4 sw=4 et
@@ -0,0 +1,31 @@
+/*
+ * Copyright (c) 2024 CogniPilot Foundation
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef ZROS_WAITSET_H
+#define ZROS_WAITSET_H
+
+#include <zephyr/kernel.h>
+
+/********************************************************************
+ * zros waitset
+ ********************************************************************/
+// forward declarations
+struct zros_waitset;
+struct zros_sub;
+
+// polls the events, a k_poll replacement gets the timeout as passed to
+// zros_waitset_wait
+typedef int zros_waitset_poll_t(struct k_poll_event* events, int num_events, k_timeout_t timeout);
+
+// public api
+void zros_waitset_init(struct zros_waitset* waitset, zros_waitset_poll_t* poll);
+int zros_waitset_add(struct zros_waitset* waitset, struct zros_sub* sub);
+uint32_t zros_waitset_take(struct zros_waitset* waitset);
+int zros_waitset_wait(struct zros_waitset* waitset, k_timeout_t timeout, uint32_t* ready);
+#ifdef CONFIG_TIMEOUT_64BIT
+int zros_waitset_wait_until(struct zros_waitset* waitset, int64_t uptime_ticks, uint32_t* ready);
+#endif
+
+#endif // ZROS_WAITSET_H
+// vi: ts=4 sw=4 et
@@ -2,7 +2,10 @@
  * Copyright (c) 2023 CogniPilot Foundation
  * SPDX-License-Identifier: Apache-2.0
  */
+#include <string.h>
+
 #include <zephyr/logging/log.h>
+#include <zephyr/sys/iterable_sections.h>
 #include <zros/private/zros_broker_struct.h>
 #include <zros/private/zros_node_struct.h>
 #include <zros/private/zros_topic_struct.h>
@@ -15,7 +18,6 @@ LOG_MODULE_REGISTER(zros, CONFIG_CEREBRI_SYNAPSE_ZROS_LOG_LEVEL);
 static const k_timeout_t g_broker_timeout = K_MSEC(1);
 static struct zros_broker _broker = {
     ._nodes = SYS_SLIST_STATIC_INIT(_broker._nodes),
-    ._topics = SYS_SLIST_STATIC_INIT(_broker._topics),
     ._lock = Z_MUTEX_INITIALIZER(_broker._lock),
 }; // singleton
 
@@ -69,36 +71,53 @@ int zros_broker_iterate_nodes(zros_node_iterator_t* iter, void* data)
     return ZROS_OK;
 }
 
-int zros_broker_add_topic(struct zros_topic* topic)
+// the linker sorts the topic section by variable name, topic_<name>, so
+// the registry is ordered by topic name
+int zros_broker_iterate_topic(zros_topic_iterator_t* iter, void* data)
 {
-    __ASSERT(&_broker != NULL, "zros broker is null");
-    ZROS_RC(_zros_broker_lock(), return rc);
-    sys_slist_append(&_broker._topics, &topic->_broker_list_node);
-    _zros_broker_unlock();
+    STRUCT_SECTION_FOREACH(zros_topic, topic)
+    {
+        iter(topic, data);
+    }
     return ZROS_OK;
 }
 
-int zros_broker_remove_topic(struct zros_topic* topic)
+size_t zros_broker_topic_count(void)
 {
-    __ASSERT(&_broker != NULL, "zros broker is null");
-    ZROS_RC(_zros_broker_lock(), return rc);
-    sys_slist_find_and_remove(&_broker._topics, &topic->_broker_list_node);
-    _zros_broker_unlock();
-    return ZROS_OK;
+    int count = 0;
+    STRUCT_SECTION_COUNT(zros_topic, &count);
+    return count;
 }
 
-int zros_broker_iterate_topic(zros_topic_iterator_t* iter, void* data)
+struct zros_topic* zros_broker_get_topic(size_t index)
 {
-    __ASSERT(&_broker != NULL, "zros broker is null");
-    ZROS_RC(_zros_broker_lock(), return rc);
-    struct zros_topic* topic;
-    SYS_SLIST_FOR_EACH_CONTAINER(
-        &_broker._topics, topic, _broker_list_node)
-    {
-        iter(topic, data);
+    if (index >= zros_broker_topic_count()) {
+        return NULL;
     }
-    _zros_broker_unlock();
-    return ZROS_OK;
+    struct zros_topic* topic = NULL;
+    STRUCT_SECTION_GET(zros_topic, index, &topic);
+    return topic;
+}
+
+struct zros_topic* zros_broker_find_topic(const char* name)
+{
+    __ASSERT(name != NULL, "zros name is null");
+    size_t low = 0;
+    size_t high = zros_broker_topic_count();
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        struct zros_topic* topic = NULL;
+        STRUCT_SECTION_GET(zros_topic, mid, &topic);
+        int cmp = strcmp(name, topic->_name);
+        if (cmp == 0) {
+            return topic;
+        } else if (cmp < 0) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+    return NULL;
 }
 
 // vi: ts=4 sw=4 et
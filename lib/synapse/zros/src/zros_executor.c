@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2024 CogniPilot Foundation
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/__assert.h>
+
+#include <zros/private/zros_executor_struct.h>
+#include <zros/private/zros_sub_struct.h>
+#include <zros/zros_common.h>
+#include <zros/zros_executor.h>
+#include <zros/zros_waitset.h>
+
+/********************************************************************
+ * zros_executor
+ ********************************************************************/
+
+LOG_MODULE_DECLARE(zros);
+
+#ifdef CONFIG_CEREBRI_CORE_WORKQUEUES
+static void _zros_executor_work_handler(struct core_work* work)
+#else
+static void _zros_executor_work_handler(struct k_work* work)
+#endif
+{
+    struct zros_executor* executor = CONTAINER_OF(work, struct zros_executor, _work);
+    // the work is idle again once the handler runs, a publish from here on
+    // submits it again and is either in this take or the next run
+    uint32_t ready = zros_waitset_take(&executor->_waitset);
+    executor->_runs++;
+    if (ready == 0) {
+        executor->_idle_runs++;
+    }
+    executor->_callback(executor, ready, executor->_user_data);
+}
+
+#ifdef CONFIG_CEREBRI_CORE_CLOCK
+static void _zros_executor_timer_handler(struct core_clock_timer* timer)
+#else
+static void _zros_executor_timer_handler(struct k_timer* timer)
+#endif
+{
+    struct zros_executor* executor = CONTAINER_OF(timer, struct zros_executor, _timer);
+    zros_executor_trigger(executor);
+}
+
+// the deadline of a run is the shortest of the period and the rate limits
+// of the subscriptions, the time until the next run can be due. a
+// subscription without a rate limit has INT64_MAX ticks and sets none
+static void _zros_executor_limit_deadline(struct zros_executor* executor, int64_t ticks)
+{
+#ifdef CONFIG_CEREBRI_CORE_WORKQUEUES
+    if (ticks <= 0 || ticks == INT64_MAX) {
+        return;
+    }
+    // clamp before converting, the conversion overflows for huge tick counts
+    ticks = MIN(ticks, (int64_t)k_us_to_ticks_ceil64(UINT32_MAX));
+    uint32_t deadline_us = (uint32_t)MIN(k_ticks_to_us_floor64(ticks), UINT32_MAX);
+    if (executor->_work._deadline_us == 0 || deadline_us < executor->_work._deadline_us) {
+        core_work_set_deadline(&executor->_work, deadline_us);
+    }
+#else
+    ARG_UNUSED(executor);
+    ARG_UNUSED(ticks);
+#endif
+}
+
+// callbacks of one executor never run concurrently, and neither do those
+// of executors sharing a queue, so nodes on a queue need no locking. the
+// name shows in the workq statistics
+void zros_executor_init(struct zros_executor* executor, const char* name,
+    struct k_work_q* queue, zros_executor_callback_t* callback, void* user_data)
+{
+    __ASSERT(executor != NULL, "zros executor is null");
+    __ASSERT(queue != NULL, "zros work queue is null");
+    __ASSERT(callback != NULL, "zros callback is null");
+#ifdef CONFIG_CEREBRI_CORE_WORKQUEUES
+    core_work_init(&executor->_work, name, queue, _zros_executor_work_handler, 0);
+#else
+    ARG_UNUSED(name);
+    k_work_init(&executor->_work, _zros_executor_work_handler);
+    executor->_queue = queue;
+#endif
+    zros_waitset_init(&executor->_waitset, NULL);
+    executor->_callback = callback;
+    executor->_user_data = user_data;
+#ifdef CONFIG_CEREBRI_CORE_CLOCK
+    core_clock_timer_init(&executor->_timer, _zros_executor_timer_handler);
+#else
+    k_timer_init(&executor->_timer, _zros_executor_timer_handler, NULL);
+#endif
+    executor->_runs = 0;
+    executor->_idle_runs = 0;
+}
+
+// publishes to the subscription submit the executor work, returns the bit
+// of the subscription in the ready mask
+int zros_executor_add(struct zros_executor* executor, struct zros_sub* sub)
+{
+    __ASSERT(executor != NULL, "zros executor is null");
+    __ASSERT(sub != NULL, "zros sub is null");
+    int i = zros_waitset_add(&executor->_waitset, sub);
+    if (i < 0) {
+        return i;
+    }
+    _zros_executor_limit_deadline(executor, sub->_min_interval_ticks);
+    // publish reads _executor without the topic lock, and it is ready
+    sub->_executor = executor;
+    // a message published before the executor was attached
+    unsigned int signaled = 0;
+    int result = 0;
+    k_poll_signal_check(&sub->_data_ready, &signaled, &result);
+    if (signaled) {
+        zros_executor_trigger(executor);
+    }
+    return i;
+}
+
+// run the callback as if a subscription had been signalled, safe from
+// interrupts, a run already queued covers this one
+int zros_executor_trigger(struct zros_executor* executor)
+{
+    __ASSERT(executor != NULL, "zros executor is null");
+#ifdef CONFIG_CEREBRI_CORE_WORKQUEUES
+    int rc = core_work_submit(&executor->_work);
+#else
+    int rc = k_work_submit_to_queue(executor->_queue, &executor->_work);
+#endif
+    return rc < 0 ? rc : ZROS_OK;
+}
+
+// also run every period, like the timeout of a waitset wait, so a node keeps
+// publishing without input
+void zros_executor_set_period(struct zros_executor* executor, k_timeout_t period)
+{
+    __ASSERT(executor != NULL, "zros executor is null");
+    if (!K_TIMEOUT_EQ(period, K_FOREVER)) {
+        _zros_executor_limit_deadline(executor, period.ticks);
+    }
+#ifdef CONFIG_CEREBRI_CORE_CLOCK
+    core_clock_timer_start(&executor->_timer, period);
+#else
+    k_timer_start(&executor->_timer, period, period);
+#endif
+}
+
+// vi: ts=4 sw=4 et
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2023 CogniPilot Foundation
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <string.h>
+
+#include <zephyr/sys/__assert.h>
+
+#include <zros/private/zros_latency_struct.h>
+#include <zros/private/zros_node_struct.h>
+#include <zros/private/zros_sub_struct.h>
+#include <zros/private/zros_topic_struct.h>
+#include <zros/zros_latency.h>
+
+/********************************************************************
+ * zros latency
+ ********************************************************************/
+
+void zros_latency_add(struct zros_latency* latency, uint32_t us)
+{
+    __ASSERT(latency != NULL, "zros latency is null");
+    if (latency->count == 0 || us < latency->min_us) {
+        latency->min_us = us;
+    }
+    if (us > latency->max_us) {
+        latency->max_us = us;
+    }
+    latency->count++;
+    latency->sum_us += us;
+    int bin = us == 0 ? 0 : 32 - __builtin_clz(us);
+    latency->hist[MIN(bin, ZROS_LATENCY_BINS - 1)]++;
+}
+
+void zros_latency_reset(struct zros_latency* latency)
+{
+    __ASSERT(latency != NULL, "zros latency is null");
+    memset(latency, 0, sizeof(*latency));
+}
+
+uint32_t zros_latency_mean_us(const struct zros_latency* latency)
+{
+    __ASSERT(latency != NULL, "zros latency is null");
+    return latency->count == 0 ? 0 : latency->sum_us / latency->count;
+}
+
+// lower bound of a histogram bin
+uint32_t zros_latency_bin_us(int bin)
+{
+    return bin == 0 ? 0 : 1U << (bin - 1);
+}
+
+// record the latency of a message the subscriber just read, and carry the
+// origin of the newest data read into the node so its publications inherit it
+void zros_latency_trace_sub(struct zros_sub* sub)
+{
+    __ASSERT(sub != NULL, "zros sub is null");
+    struct zros_topic* topic = sub->_topic;
+
+    // stamps are only read once per new message, a publish racing this read
+    // at worst attributes the stamps of the next message
+    atomic_val_t published = atomic_get(&topic->_published);
+    if (published == sub->_traced) {
+        return;
+    }
+    sub->_traced = published;
+
+    uint32_t now = k_cycle_get_32();
+    uint32_t publish = topic->_publish_cycles;
+    uint32_t origin = topic->_origin_cycles;
+    zros_latency_add(&sub->_delivery, k_cyc_to_us_floor32(now - publish));
+    zros_latency_add(&sub->_end_to_end, k_cyc_to_us_floor32(now - origin));
+
+    struct zros_node* node = sub->_node;
+    if (node->_origin_cycles == 0 || (int32_t)(origin - node->_origin_cycles) > 0) {
+        node->_origin_cycles = origin;
+    }
+}
+
+// vi: ts=4 sw=4 et
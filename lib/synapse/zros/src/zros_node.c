@@ -31,6 +31,9 @@ void zros_node_init(struct zros_node* node, const char* name)
     sys_slist_init(&node->_subs);
     sys_slist_init(&node->_pubs);
     k_mutex_init(&node->_lock);
+#ifdef CONFIG_CEREBRI_SYNAPSE_ZROS_LATENCY
+    node->_origin_cycles = 0;
+#endif
     zros_broker_add_node(node);
 };
 
@@ -37,6 +37,7 @@ int zros_pub_init(struct zros_pub* pub, struct zros_node* node, struct zros_topi
     pub->_topic = topic;
     pub->_data = data;
     pub->_node = node;
+    pub->_loan = -1;
 
     return zros_topic_add_pub(topic, pub);
 };
@@ -44,7 +45,36 @@ int zros_pub_init(struct zros_pub* pub, struct zros_node* node, struct zros_topi
 int zros_pub_update(struct zros_pub* pub)
 {
     __ASSERT(pub != NULL, "zros pub is null");
-    return zros_topic_publish(pub->_topic, pub->_data);
+    return _zros_topic_publish(pub->_topic, pub->_data, pub->_node);
+}
+
+int zros_pub_loan(struct zros_pub* pub, void** data)
+{
+    __ASSERT(pub != NULL, "zros pub is null");
+    __ASSERT(pub->_loan < 0, "zros pub already has a loan");
+    int slot = zros_topic_loan(pub->_topic, data);
+    if (slot < 0) {
+        return slot;
+    }
+    pub->_loan = slot;
+    return ZROS_OK;
+}
+
+int zros_pub_commit(struct zros_pub* pub)
+{
+    __ASSERT(pub != NULL, "zros pub is null");
+    __ASSERT(pub->_loan >= 0, "zros pub has no loan");
+    int slot = pub->_loan;
+    pub->_loan = -1;
+    return _zros_topic_commit(pub->_topic, slot, pub->_node);
+}
+
+void zros_pub_cancel(struct zros_pub* pub)
+{
+    __ASSERT(pub != NULL, "zros pub is null");
+    __ASSERT(pub->_loan >= 0, "zros pub has no loan");
+    zros_topic_cancel(pub->_topic, pub->_loan);
+    pub->_loan = -1;
 }
 
 void zros_pub_fini(struct zros_pub* pub)
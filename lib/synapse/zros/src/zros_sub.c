@@ -8,6 +8,7 @@
 #include <zros/private/zros_sub_struct.h>
 #include <zros/private/zros_topic_struct.h>
 #include <zros/zros_common.h>
+#include <zros/zros_latency.h>
 #include <zros/zros_node.h>
 #include <zros/zros_sub.h>
 #include <zros/zros_topic.h>
@@ -36,31 +37,91 @@ int zros_sub_init(struct zros_sub* sub, struct zros_node* node, struct zros_topi
     sub->_data = data;
     k_poll_signal_init(&sub->_data_ready);
     sub->_rate_limit_hz = rate_limit_hz;
+    // publish only compares ticks, a limit above the tick rate disables it
+    if (rate_limit_hz > 0) {
+        sub->_min_interval_ticks = (int64_t)(CONFIG_SYS_CLOCK_TICKS_PER_SEC / rate_limit_hz);
+    } else {
+        sub->_min_interval_ticks = INT64_MAX;
+    }
     sub->_last_update_ticks = 0;
     sub->_node_list_node.next = NULL;
     sub->_topic_list_node.next = NULL;
     k_poll_event_init(&sub->_event, K_POLL_TYPE_SIGNAL,
         K_POLL_MODE_NOTIFY_ONLY, &sub->_data_ready);
+    sub->_executor = NULL;
     sub->_node = node;
+    sub->_borrow = -1;
+    sub->_cursor = atomic_get(&topic->_published);
+    sub->_lost = 0;
+    sub->_signals = 0;
+    sub->_skips = 0;
+    sub->_reads = 0;
+    sub->_lock_timeouts = 0;
+#ifdef CONFIG_CEREBRI_SYNAPSE_ZROS_LATENCY
+    sub->_traced = sub->_cursor;
+    zros_latency_reset(&sub->_delivery);
+    zros_latency_reset(&sub->_end_to_end);
+#endif
     return zros_topic_add_sub(topic, sub);
 }
 
 int zros_sub_update(struct zros_sub* sub)
 {
     __ASSERT(sub != NULL, "zros sub is null");
-    return zros_topic_read(sub->_topic, sub->_data);
+    ZROS_RC(zros_topic_read(sub->_topic, sub->_data),
+            sub->_lock_timeouts++;
+            return rc);
+    sub->_reads++;
+#ifdef CONFIG_CEREBRI_SYNAPSE_ZROS_LATENCY
+    zros_latency_trace_sub(sub);
+#endif
+    return ZROS_OK;
+}
+
+int zros_sub_borrow(struct zros_sub* sub, const void** data)
+{
+    __ASSERT(sub != NULL, "zros sub is null");
+    __ASSERT(sub->_borrow < 0, "zros sub already has a borrow");
+    int slot = zros_topic_borrow(sub->_topic, data);
+    if (slot < 0) {
+        return slot;
+    }
+    sub->_borrow = slot;
+    sub->_reads++;
+#ifdef CONFIG_CEREBRI_SYNAPSE_ZROS_LATENCY
+    zros_latency_trace_sub(sub);
+#endif
+    return ZROS_OK;
+}
+
+void zros_sub_release(struct zros_sub* sub)
+{
+    __ASSERT(sub != NULL, "zros sub is null");
+    __ASSERT(sub->_borrow >= 0, "zros sub has no borrow");
+    zros_topic_release(sub->_topic, sub->_borrow);
+    sub->_borrow = -1;
+}
+
+// copy up to n unread history messages, oldest first, into the array data
+int zros_sub_drain(struct zros_sub* sub, void* data, int n)
+{
+    __ASSERT(sub != NULL, "zros sub is null");
+    return zros_topic_read_history(sub->_topic, &sub->_cursor, data, n, &sub->_lost);
 }
 
 bool zros_sub_update_available(struct zros_sub* sub)
 {
     __ASSERT(sub != NULL, "zros sub is null");
-    if (sub->_event.signal->signaled == 1) {
-        sub->_event.signal->signaled = 0;
-        sub->_event.state = K_POLL_STATE_NOT_READY;
-        return true;
-    } else {
+    unsigned int signaled = 0;
+    int result = 0;
+    k_poll_signal_check(&sub->_data_ready, &signaled, &result);
+    if (!signaled) {
         return false;
     }
+    // reset before the caller reads, a publish in between signals again
+    k_poll_signal_reset(&sub->_data_ready);
+    sub->_event.state = K_POLL_STATE_NOT_READY;
+    return true;
 }
 
 struct k_poll_event* zros_sub_get_event(struct zros_sub* sub)
@@ -7,11 +7,18 @@
 #include <string.h>
 
 #include <zephyr/logging/log.h>
+#include <zephyr/sys/barrier.h>
 
+#ifdef CONFIG_CEREBRI_CORE_CLOCK
+#include <cerebri/core/clock.h>
+#endif
+
+#include <zros/private/zros_node_struct.h>
 #include <zros/private/zros_pub_struct.h>
 #include <zros/private/zros_sub_struct.h>
 #include <zros/private/zros_topic_struct.h>
 #include <zros/zros_common.h>
+#include <zros/zros_executor.h>
 #include <zros/zros_node.h>
 #include <zros/zros_pub.h>
 #include <zros/zros_sub.h>
@@ -25,6 +32,16 @@ LOG_MODULE_DECLARE(zros);
 
 static const k_timeout_t g_topic_timeout = K_MSEC(1);
 
+// the rate limit follows the cerebri clock, so it holds in stepped time
+static int64_t _zros_topic_now(void)
+{
+#ifdef CONFIG_CEREBRI_CORE_CLOCK
+    return core_clock_ticks();
+#else
+    return k_uptime_ticks();
+#endif
+}
+
 int _zros_topic_read_write_lock(struct zros_topic* topic)
 {
     __ASSERT(topic != NULL, "zros topic is null");
@@ -33,6 +50,7 @@ int _zros_topic_read_write_lock(struct zros_topic* topic)
 
     // take write semaphore
     ZROS_RC(k_mutex_lock(write, g_topic_timeout),
+            atomic_inc(&topic->_lock_timeouts);
             LOG_ERR("write lock failed\n");
             return rc);
 
@@ -41,6 +59,7 @@ int _zros_topic_read_write_lock(struct zros_topic* topic)
     while (true) {
         int rc = k_sem_take(read, g_topic_timeout);
         if (rc != 0) {
+            atomic_inc(&topic->_lock_timeouts);
             char name[20];
             zros_topic_get_name(topic, name, sizeof(name));
             LOG_ERR("topic %s take read: %u/%u failed\n", name, read_take_count, read->limit);
@@ -78,6 +97,7 @@ int _zros_topic_read_lock(const struct zros_topic* topic)
     __ASSERT(topic != NULL, "zros topic is null");
     struct k_sem* read = (struct k_sem*)&topic->_sem_read;
     ZROS_RC(k_sem_take(read, g_topic_timeout),
+            atomic_inc((atomic_t*)&topic->_lock_timeouts);
             LOG_ERR("take read failed\n");
             return rc);
     return ZROS_OK;
@@ -90,92 +110,227 @@ void _zros_topic_read_unlock(const struct zros_topic* topic)
     k_sem_give(read);
 };
 
+// pub/sub list modification, seqlock and loan readers never touch the lists
+int _zros_topic_list_write_lock(struct zros_topic* topic)
+{
+    __ASSERT(topic != NULL, "zros topic is null");
+    if (topic->_mode != ZROS_TOPIC_MODE_LOCK) {
+        ZROS_RC(k_mutex_lock(&topic->_lock_write, g_topic_timeout),
+                atomic_inc(&topic->_lock_timeouts);
+                LOG_ERR("write lock failed\n");
+                return rc);
+        return ZROS_OK;
+    }
+    return _zros_topic_read_write_lock(topic);
+}
+
+void _zros_topic_list_write_unlock(struct zros_topic* topic)
+{
+    __ASSERT(topic != NULL, "zros topic is null");
+    if (topic->_mode != ZROS_TOPIC_MODE_LOCK) {
+        k_mutex_unlock(&topic->_lock_write);
+        return;
+    }
+    _zros_topic_read_write_unlock(topic);
+}
+
+// pub/sub list iteration
+int _zros_topic_list_read_lock(struct zros_topic* topic)
+{
+    __ASSERT(topic != NULL, "zros topic is null");
+    if (topic->_mode != ZROS_TOPIC_MODE_LOCK) {
+        return _zros_topic_list_write_lock(topic);
+    }
+    return _zros_topic_read_lock(topic);
+}
+
+void _zros_topic_list_read_unlock(struct zros_topic* topic)
+{
+    __ASSERT(topic != NULL, "zros topic is null");
+    if (topic->_mode != ZROS_TOPIC_MODE_LOCK) {
+        _zros_topic_list_write_unlock(topic);
+        return;
+    }
+    _zros_topic_read_unlock(topic);
+}
+
+// seqlock buffer holding the result of write number seq / 2
+static inline void* _zros_topic_seqlock_buf(const struct zros_topic* topic, atomic_val_t seq)
+{
+    return (uint8_t*)topic->_data + ((seq >> 1) & 1) * topic->_size;
+}
+
+static inline void* _zros_topic_slot_buf(const struct zros_topic* topic, int slot)
+{
+    return (uint8_t*)topic->_data + slot * topic->_size;
+}
+
 int zros_topic_add_pub(struct zros_topic* topic, struct zros_pub* pub)
 {
     __ASSERT(topic != NULL, "zros topic is null");
-    ZROS_RC(_zros_topic_read_write_lock(topic),
+    ZROS_RC(_zros_topic_list_write_lock(topic),
             LOG_ERR("pub read lock failed");
             return rc);
     sys_slist_append(&topic->_pubs, &pub->_topic_list_node);
-    _zros_topic_read_write_unlock(topic);
+    _zros_topic_list_write_unlock(topic);
     return ZROS_OK;
 }
 
 int zros_topic_remove_pub(struct zros_topic* topic, struct zros_pub* pub)
 {
     __ASSERT(topic != NULL, "zros topic is null");
-    ZROS_RC(_zros_topic_read_write_lock(topic),
+    ZROS_RC(_zros_topic_list_write_lock(topic),
             LOG_ERR("pub read lock failed");
             return rc);
     sys_slist_find_and_remove(&topic->_pubs, &pub->_topic_list_node);
-    _zros_topic_read_write_unlock(topic);
+    _zros_topic_list_write_unlock(topic);
     return ZROS_OK;
 }
 
 int zros_topic_add_sub(struct zros_topic* topic, struct zros_sub* sub)
 {
     __ASSERT(topic != NULL, "zros topic is null");
-    ZROS_RC(_zros_topic_read_write_lock(topic),
+    ZROS_RC(_zros_topic_list_write_lock(topic),
             LOG_ERR("topic read lock failed");
             return rc);
     sys_slist_append(&topic->_subs, &sub->_topic_list_node);
-    _zros_topic_read_write_unlock(topic);
+    _zros_topic_list_write_unlock(topic);
     return ZROS_OK;
 }
 
 int zros_topic_remove_sub(struct zros_topic* topic, struct zros_sub* sub)
 {
     __ASSERT(topic != NULL, "zros topic is null");
-    ZROS_RC(_zros_topic_read_write_lock(topic),
+    ZROS_RC(_zros_topic_list_write_lock(topic),
             LOG_ERR("topic read lock failed");
             return rc);
     sys_slist_find_and_remove(&topic->_subs, &sub->_topic_list_node);
-    _zros_topic_read_write_unlock(topic);
+    _zros_topic_list_write_unlock(topic);
     return ZROS_OK;
 }
 
-int zros_topic_publish(struct zros_topic* topic, void* data)
+// append the message to the history ring, caller holds the write lock
+static void _zros_topic_record(struct zros_topic* topic, const void* data)
 {
-    __ASSERT(topic != NULL, "zros topic is null");
-    char topic_name[30];
-    char node_name[30];
-
-    // read/write lock
-    ZROS_RC(_zros_topic_read_write_lock(topic),
-            LOG_ERR("topic r/w lock failed");
-            return rc);
-
-    zros_topic_get_name(topic, topic_name, sizeof(topic_name));
+    atomic_val_t n = atomic_get(&topic->_published) + 1;
+    if (topic->_history != NULL) {
+        // stamp 0 while copying, so a drain overlapping the write detects it
+        int entry = n % topic->_history_depth;
+        atomic_set(&topic->_history_seq[entry], 0);
+        memcpy((uint8_t*)topic->_history + entry * topic->_size, data, topic->_size);
+        atomic_set(&topic->_history_seq[entry], n);
+    }
+    atomic_set(&topic->_published, n);
+}
 
-    // write latest data for subscribers
-    memcpy(topic->_data, data, topic->_size);
-    // LOG_WRN("\npublishing topic %s", topic_name);
+#ifdef CONFIG_CEREBRI_SYNAPSE_ZROS_LATENCY
+// stamp the publish, the data originates where the newest input of the
+// publishing node did, or here if it has none
+static void _zros_topic_stamp(struct zros_topic* topic, const struct zros_node* node)
+{
+    uint32_t now = k_cycle_get_32();
+    topic->_publish_cycles = now;
+    topic->_origin_cycles = (node != NULL && node->_origin_cycles != 0) ? node->_origin_cycles : now;
+}
+#endif
 
-    // write data to subscribers
+// record the message and signal subscribers, caller holds the write lock
+static void _zros_topic_notify(struct zros_topic* topic, const void* data,
+    const struct zros_node* node)
+{
+#ifdef CONFIG_CEREBRI_SYNAPSE_ZROS_LATENCY
+    _zros_topic_stamp(topic, node);
+#endif
+    _zros_topic_record(topic, data);
+    int64_t now = _zros_topic_now();
+    topic->_last_publish_ticks = now;
     struct zros_sub* sub;
     SYS_SLIST_FOR_EACH_CONTAINER(
         &topic->_subs, sub, _topic_list_node)
     {
-        int64_t now = k_uptime_ticks();
-        zros_node_get_name(sub->_node, node_name, sizeof(node_name));
-        double hz = (double)CONFIG_SYS_CLOCK_TICKS_PER_SEC / (now - sub->_last_update_ticks);
-        if (hz <= sub->_rate_limit_hz) {
+        // a clock reset moves now back, let the next publish through
+        if (now - sub->_last_update_ticks >= sub->_min_interval_ticks
+            || now < sub->_last_update_ticks) {
             k_poll_signal_raise(&sub->_data_ready, 1);
+            if (sub->_executor != NULL) {
+                // before the queue is started this fails, the executor
+                // takes the signal on its first run
+                zros_executor_trigger(sub->_executor);
+            }
             sub->_last_update_ticks = now;
-            // LOG_WRN("subscriber %s: update", node_name);
+            sub->_signals++;
         } else {
-            // LOG_WRN("subscriber %s: ignore", node_name);
+            sub->_skips++;
         }
     }
+}
+
+int zros_topic_publish(struct zros_topic* topic, void* data)
+{
+    return _zros_topic_publish(topic, data, NULL);
+}
+
+int _zros_topic_publish(struct zros_topic* topic, void* data, const struct zros_node* node)
+{
+    __ASSERT(topic != NULL, "zros topic is null");
+
+    if (topic->_mode == ZROS_TOPIC_MODE_LOAN) {
+        void* buf = NULL;
+        int slot = zros_topic_loan(topic, &buf);
+        if (slot < 0) {
+            return slot;
+        }
+        memcpy(buf, data, topic->_size);
+        return _zros_topic_commit(topic, slot, node);
+    }
+
+    // lock out other writers, and readers unless seqlock
+    ZROS_RC(_zros_topic_list_write_lock(topic),
+            LOG_ERR("topic r/w lock failed");
+            return rc);
+
+    // write latest data for subscribers
+    if (topic->_mode == ZROS_TOPIC_MODE_SEQLOCK) {
+        // odd sequence marks the write of the buffer readers are not using
+        atomic_val_t seq = atomic_inc(&topic->_seq) + 1;
+        memcpy(_zros_topic_seqlock_buf(topic, seq + 1), data, topic->_size);
+        atomic_inc(&topic->_seq);
+    } else {
+        memcpy(topic->_data, data, topic->_size);
+    }
+
+    // write data to subscribers
+    _zros_topic_notify(topic, data, node);
 
     // read/write unlock
-    _zros_topic_read_write_unlock(topic);
+    _zros_topic_list_write_unlock(topic);
     return ZROS_OK;
 }
 
 int zros_topic_read(struct zros_topic* topic, void* data)
 {
     __ASSERT(topic != NULL, "zros topic is null");
+    if (topic->_mode == ZROS_TOPIC_MODE_SEQLOCK) {
+        while (true) {
+            // copy the latest complete buffer, the writer only reuses it for
+            // the second write after it, so retry if that one has started
+            atomic_val_t start = atomic_get(&topic->_seq);
+            memcpy(data, _zros_topic_seqlock_buf(topic, start), topic->_size);
+            barrier_dmem_fence_full();
+            if (atomic_get(&topic->_seq) - (start & ~1) <= 2) {
+                return ZROS_OK;
+            }
+        }
+    } else if (topic->_mode == ZROS_TOPIC_MODE_LOAN) {
+        const void* buf = NULL;
+        int slot = zros_topic_borrow(topic, &buf);
+        if (slot < 0) {
+            return slot;
+        }
+        memcpy(data, buf, topic->_size);
+        zros_topic_release(topic, slot);
+        return ZROS_OK;
+    }
     ZROS_RC(_zros_topic_read_lock(topic),
             LOG_ERR("topic read lock failed");
             return rc);
@@ -184,6 +339,127 @@ int zros_topic_read(struct zros_topic* topic, void* data)
     return ZROS_OK;
 }
 
+int zros_topic_loan(struct zros_topic* topic, void** data)
+{
+    __ASSERT(topic != NULL, "zros topic is null");
+    __ASSERT(data != NULL, "zros data is null");
+    if (topic->_mode != ZROS_TOPIC_MODE_LOAN) {
+        return -ENOTSUP;
+    }
+
+    // held until commit, so loan and commit must be called from one thread
+    ZROS_RC(_zros_topic_list_write_lock(topic),
+            LOG_ERR("topic write lock failed");
+            return rc);
+
+    // pick the oldest buffer that is neither the latest nor borrowed, a
+    // subscriber can only start borrowing the latest buffer
+    const int slots = ZROS_TOPIC_MODE_BUFFERS(topic->_mode);
+    int latest = atomic_get(&topic->_latest);
+    for (int i = 1; i < slots; i++) {
+        int slot = (latest + i) % slots;
+        if (atomic_get(&topic->_refs[slot]) == 0) {
+            *data = _zros_topic_slot_buf(topic, slot);
+            return slot;
+        }
+    }
+
+    _zros_topic_list_write_unlock(topic);
+    char name[20];
+    zros_topic_get_name(topic, name, sizeof(name));
+    LOG_ERR("topic %s no free buffer to loan", name);
+    return -EBUSY;
+}
+
+int zros_topic_commit(struct zros_topic* topic, int slot)
+{
+    return _zros_topic_commit(topic, slot, NULL);
+}
+
+int _zros_topic_commit(struct zros_topic* topic, int slot, const struct zros_node* node)
+{
+    __ASSERT(topic != NULL, "zros topic is null");
+    __ASSERT(slot >= 0 && slot < ZROS_TOPIC_MODE_BUFFERS(topic->_mode), "zros slot is invalid");
+    atomic_set(&topic->_latest, slot);
+    _zros_topic_notify(topic, _zros_topic_slot_buf(topic, slot), node);
+    _zros_topic_list_write_unlock(topic);
+    return ZROS_OK;
+}
+
+// return a loaned buffer unpublished, e.g. when filling it failed
+void zros_topic_cancel(struct zros_topic* topic, int slot)
+{
+    __ASSERT(topic != NULL, "zros topic is null");
+    __ASSERT(slot >= 0 && slot < ZROS_TOPIC_MODE_BUFFERS(topic->_mode), "zros slot is invalid");
+    _zros_topic_list_write_unlock(topic);
+}
+
+int zros_topic_borrow(struct zros_topic* topic, const void** data)
+{
+    __ASSERT(topic != NULL, "zros topic is null");
+    __ASSERT(data != NULL, "zros data is null");
+    if (topic->_mode != ZROS_TOPIC_MODE_LOAN) {
+        return -ENOTSUP;
+    }
+    while (true) {
+        // pin the latest buffer, if a commit moved latest before the pin
+        // the buffer may already be loaned again, so drop it and retry
+        int slot = atomic_get(&topic->_latest);
+        atomic_inc(&topic->_refs[slot]);
+        if (atomic_get(&topic->_latest) == slot) {
+            *data = _zros_topic_slot_buf(topic, slot);
+            return slot;
+        }
+        atomic_dec(&topic->_refs[slot]);
+    }
+}
+
+void zros_topic_release(struct zros_topic* topic, int slot)
+{
+    __ASSERT(topic != NULL, "zros topic is null");
+    __ASSERT(slot >= 0 && slot < ZROS_TOPIC_MODE_BUFFERS(topic->_mode), "zros slot is invalid");
+    atomic_dec(&topic->_refs[slot]);
+}
+
+int zros_topic_read_history(struct zros_topic* topic, atomic_val_t* cursor, void* data, int n,
+    uint32_t* lost)
+{
+    __ASSERT(topic != NULL, "zros topic is null");
+    __ASSERT(cursor != NULL, "zros cursor is null");
+    if (topic->_history == NULL) {
+        return -ENOTSUP;
+    }
+
+    const int depth = topic->_history_depth;
+    atomic_val_t last = atomic_get(&topic->_published);
+    atomic_val_t next = *cursor + 1;
+
+    // skip messages already overwritten, the entry after last may be in use
+    // by the next write, so only depth - 1 messages can be relied on
+    if (last - next >= depth - 1) {
+        *lost += last - (depth - 1) + 1 - next;
+        next = last - (depth - 1) + 1;
+    }
+
+    int count = 0;
+    for (; next <= last && count < n; next++) {
+        int entry = next % depth;
+        uint8_t* dst = (uint8_t*)data + count * topic->_size;
+        if (atomic_get(&topic->_history_seq[entry]) == next) {
+            memcpy(dst, (uint8_t*)topic->_history + entry * topic->_size, topic->_size);
+            barrier_dmem_fence_full();
+            if (atomic_get(&topic->_history_seq[entry]) == next) {
+                count++;
+                continue;
+            }
+        }
+        // overwritten while copying, the writer lapped this cursor
+        (*lost)++;
+    }
+    *cursor = next - 1;
+    return count;
+}
+
 int zros_topic_get_name(const struct zros_topic* topic, char* buf, size_t n)
 {
     __ASSERT(topic != NULL, "zros topic is null");
@@ -195,7 +471,7 @@ int zros_topic_get_name(const struct zros_topic* topic, char* buf, size_t n)
 int zros_topic_iterate_pub(struct zros_topic* topic, zros_pub_iterator_t* iter, void* data)
 {
     __ASSERT(topic != NULL, "zros topic is null");
-    ZROS_RC(_zros_topic_read_lock(topic),
+    ZROS_RC(_zros_topic_list_read_lock(topic),
             LOG_ERR("topic read lock failed");
             return rc);
     struct zros_pub* pub;
@@ -205,14 +481,14 @@ int zros_topic_iterate_pub(struct zros_topic* topic, zros_pub_iterator_t* iter,
         __ASSERT(pub != NULL, "pub is null");
         iter(pub, data);
     }
-    _zros_topic_read_unlock(topic);
+    _zros_topic_list_read_unlock(topic);
     return ZROS_OK;
 }
 
 int zros_topic_iterate_sub(struct zros_topic* topic, zros_sub_iterator_t* iter, void* data)
 {
     __ASSERT(topic != NULL, "zros topic is null");
-    ZROS_RC(_zros_topic_read_lock(topic),
+    ZROS_RC(_zros_topic_list_read_lock(topic),
             LOG_ERR("topic read lock failed");
             return rc);
     struct zros_sub* sub;
@@ -222,7 +498,7 @@ int zros_topic_iterate_sub(struct zros_topic* topic, zros_sub_iterator_t* iter,
         __ASSERT(sub != NULL, "sub is null");
         iter(sub, data);
     }
-    _zros_topic_read_unlock(topic);
+    _zros_topic_list_read_unlock(topic);
     return ZROS_OK;
 }
 
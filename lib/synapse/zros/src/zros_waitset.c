@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2024 CogniPilot Foundation
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/__assert.h>
+
+#include <zros/private/zros_sub_struct.h>
+#include <zros/private/zros_waitset_struct.h>
+#include <zros/zros_common.h>
+#include <zros/zros_waitset.h>
+
+/********************************************************************
+ * zros_waitset
+ ********************************************************************/
+
+LOG_MODULE_DECLARE(zros);
+
+BUILD_ASSERT(CONFIG_CEREBRI_SYNAPSE_ZROS_WAITSET_SIZE <= 32, "zros waitset ready mask is 32 bit");
+
+void zros_waitset_init(struct zros_waitset* waitset, zros_waitset_poll_t* poll)
+{
+    __ASSERT(waitset != NULL, "zros waitset is null");
+    waitset->_count = 0;
+    waitset->_poll = poll != NULL ? poll : k_poll;
+    waitset->_polls = 0;
+    waitset->_wakeups = 0;
+}
+
+// returns the bit of the subscription in the ready mask
+int zros_waitset_add(struct zros_waitset* waitset, struct zros_sub* sub)
+{
+    __ASSERT(waitset != NULL, "zros waitset is null");
+    __ASSERT(sub != NULL, "zros sub is null");
+    if (waitset->_count == CONFIG_CEREBRI_SYNAPSE_ZROS_WAITSET_SIZE) {
+        LOG_ERR("zros waitset full");
+        return -ENOMEM;
+    }
+    int i = waitset->_count++;
+    waitset->_subs[i] = sub;
+    k_poll_event_init(&waitset->_events[i], K_POLL_TYPE_SIGNAL,
+        K_POLL_MODE_NOTIFY_ONLY, &sub->_data_ready);
+    return i;
+}
+
+// mask of subscriptions signalled since the last take, without blocking.
+// the signal is reset before the caller reads the topic, so a publish
+// racing with the take is either in this read or signals the next wait.
+uint32_t zros_waitset_take(struct zros_waitset* waitset)
+{
+    __ASSERT(waitset != NULL, "zros waitset is null");
+    uint32_t ready = 0;
+    for (int i = 0; i < waitset->_count; i++) {
+        struct k_poll_signal* signal = &waitset->_subs[i]->_data_ready;
+        unsigned int signaled = 0;
+        int result = 0;
+        k_poll_signal_check(signal, &signaled, &result);
+        if (signaled) {
+            k_poll_signal_reset(signal);
+            ready |= BIT(i);
+        }
+    }
+    return ready;
+}
+
+// wait for any subscription, updates already signalled return at once, so
+// a burst of publishes costs one wakeup. returns -EAGAIN on timeout.
+int zros_waitset_wait(struct zros_waitset* waitset, k_timeout_t timeout, uint32_t* ready)
+{
+    __ASSERT(waitset != NULL, "zros waitset is null");
+    __ASSERT(ready != NULL, "zros ready is null");
+    *ready = zros_waitset_take(waitset);
+    if (*ready == 0) {
+        for (int i = 0; i < waitset->_count; i++) {
+            waitset->_events[i].state = K_POLL_STATE_NOT_READY;
+        }
+        int rc = waitset->_poll(waitset->_events, waitset->_count, timeout);
+        waitset->_polls++;
+        *ready = zros_waitset_take(waitset);
+        if (*ready == 0) {
+            return rc < 0 ? rc : -EAGAIN;
+        }
+    }
+    waitset->_wakeups++;
+    return ZROS_OK;
+}
+
+#ifdef CONFIG_TIMEOUT_64BIT
+// wait until an absolute uptime at most
+int zros_waitset_wait_until(struct zros_waitset* waitset, int64_t uptime_ticks, uint32_t* ready)
+{
+    return zros_waitset_wait(waitset, K_TIMEOUT_ABS_TICKS(uptime_ticks), ready);
+}
+#endif
+
+// vi: ts=4 sw=4 et
@@ -0,0 +1,769 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <pb_decode.h>
+#include <pb_encode.h>
+
+#include <synapse_protobuf/actuators.pb.h>
+#include <synapse_protobuf/imu.pb.h>
+#include <synapse_protobuf/joy.pb.h>
+#include <synapse_protobuf/led_array.pb.h>
+#include <synapse_protobuf/road_curve_angle.pb.h>
+#include <synapse_protobuf/status.pb.h>
+
+extern "C" {
+#include <cerebri/synapse/log_format.h>
+#include <synapse_tinyframe/SynapseTopics.h>
+#include <synapse_tinyframe/TinyFrame.h>
+}
+
+// host side tool for the synapse udp link
+//
+//   record: parse tinyframe frames from udp, decode them and write a log
+//   replay: send a log to syn_eth_rx, at the recorded timing or flat out
+//   dump:   decode and print a log
+//   load:   flood syn_eth_rx with joy and road_curve_angle frames at rising
+//           rates and measure joy to actuators latency at each rate, the
+//           latency includes the rate limits on the path, see load_floor_ms
+//
+// logs are in the format of cerebri/synapse/log_format.h, the same as
+// syn_log writes and syn_replay reads, with times in ns since the first
+// frame. payloads are kept encoded, so a log does not depend on the
+// message definitions it was recorded with.
+
+using Clock = std::chrono::steady_clock;
+
+static volatile std::sig_atomic_t g_stop = 0;
+
+/********************************************************************
+ * decoding
+ ********************************************************************/
+struct MsgType {
+    const char* name;
+    const pb_msgdesc_t* fields;
+    std::size_t size;
+};
+
+static const std::map<int, MsgType> g_types = {
+    { SYNAPSE_ACTUATORS_TOPIC, { "actuators", synapse_msgs_Actuators_fields, sizeof(synapse_msgs_Actuators) } },
+    { SYNAPSE_IMU_TOPIC, { "imu", synapse_msgs_Imu_fields, sizeof(synapse_msgs_Imu) } },
+    { SYNAPSE_JOY_TOPIC, { "joy", synapse_msgs_Joy_fields, sizeof(synapse_msgs_Joy) } },
+    { SYNAPSE_LED_ARRAY_TOPIC, { "led_array", synapse_msgs_LEDArray_fields, sizeof(synapse_msgs_LEDArray) } },
+    { SYNAPSE_ROAD_CURVE_ANGLE_TOPIC, { "road_curve_angle", synapse_msgs_RoadCurveAngle_fields, sizeof(synapse_msgs_RoadCurveAngle) } },
+    { SYNAPSE_STATUS_TOPIC, { "status", synapse_msgs_Status_fields, sizeof(synapse_msgs_Status) } },
+};
+
+union AnyMsg {
+    synapse_msgs_Actuators actuators;
+    synapse_msgs_Imu imu;
+    synapse_msgs_Joy joy;
+    synapse_msgs_LEDArray led_array;
+    synapse_msgs_RoadCurveAngle road_curve_angle;
+    synapse_msgs_Status status;
+};
+
+struct TypeStats {
+    uint64_t frames = 0;
+    uint64_t bytes = 0;
+    uint64_t failed = 0;
+};
+
+class Decoder {
+public:
+    // returns the message name, or nullptr if the type is unknown
+    const char* decode(int type, const uint8_t* data, std::size_t len, bool* ok)
+    {
+        TypeStats& stats = stats_[type];
+        stats.frames++;
+        stats.bytes += len;
+        auto it = g_types.find(type);
+        if (it == g_types.end()) {
+            stats.failed++;
+            *ok = false;
+            return nullptr;
+        }
+        std::memset(&msg_, 0, it->second.size);
+        pb_istream_t stream = pb_istream_from_buffer(data, len);
+        *ok = pb_decode(&stream, it->second.fields, &msg_);
+        if (!*ok) {
+            stats.failed++;
+        }
+        return it->second.name;
+    }
+
+    void print(const char* label, double seconds)
+    {
+        for (const auto& [type, stats] : stats_) {
+            auto it = g_types.find(type);
+            std::printf("%s %-16s %8.0f frames/s %10.0f B/s failed %lu\n", label,
+                it == g_types.end() ? "unknown" : it->second.name,
+                stats.frames / seconds, stats.bytes / seconds, (unsigned long)stats.failed);
+        }
+        std::fflush(stdout);
+    }
+
+    void reset() { stats_.clear(); }
+
+private:
+    AnyMsg msg_;
+    std::map<int, TypeStats> stats_;
+};
+
+/********************************************************************
+ * log
+ ********************************************************************/
+struct Record {
+    uint64_t t_ns;
+    uint16_t type;
+    std::vector<uint8_t> data;
+};
+
+static bool write_record(std::ostream& os, uint64_t t_ns, int type, const uint8_t* data, std::size_t len)
+{
+    if (len > UINT16_MAX) {
+        return false;
+    }
+    uint8_t b[SYNAPSE_LOG_RECORD_HEADER_SIZE];
+    synapse_log_put_record_header(b, t_ns, type, len);
+    os.write(reinterpret_cast<const char*>(b), sizeof(b));
+    os.write(reinterpret_cast<const char*>(data), len);
+    return true;
+}
+
+static bool read_record(std::istream& is, Record* r)
+{
+    uint8_t b[SYNAPSE_LOG_RECORD_HEADER_SIZE];
+    if (!is.read(reinterpret_cast<char*>(b), sizeof(b))) {
+        return false;
+    }
+    synapse_log_record_header hdr;
+    synapse_log_get_record_header(b, &hdr);
+    r->t_ns = hdr.t_ns;
+    r->type = hdr.type;
+    r->data.resize(hdr.len);
+    return static_cast<bool>(is.read(reinterpret_cast<char*>(r->data.data()), hdr.len));
+}
+
+static bool open_log(std::ifstream& is, const char* path)
+{
+    is.open(path, std::ios::binary);
+    char magic[SYNAPSE_LOG_MAGIC_SIZE];
+    if (!is || !is.read(magic, sizeof(magic)) || std::memcmp(magic, SYNAPSE_LOG_MAGIC, sizeof(magic)) != 0) {
+        std::cerr << path << ": not a synapse log\n";
+        return false;
+    }
+    return true;
+}
+
+/********************************************************************
+ * udp
+ ********************************************************************/
+// ip or ip:port, port defaults to 4242
+static bool parse_endpoint(const std::string& s, sockaddr_in* addr)
+{
+    std::memset(addr, 0, sizeof(*addr));
+    addr->sin_family = AF_INET;
+    std::size_t colon = s.rfind(':');
+    std::string ip = colon == std::string::npos ? s : s.substr(0, colon);
+    int port = colon == std::string::npos ? 4242 : std::atoi(s.substr(colon + 1).c_str());
+    addr->sin_port = htons(port);
+    return inet_pton(AF_INET, ip.c_str(), &addr->sin_addr) == 1;
+}
+
+/********************************************************************
+ * record
+ ********************************************************************/
+struct RecordContext {
+    std::ofstream* log;
+    Decoder decoder;
+    Clock::time_point start;
+    bool started = false;
+    bool verbose = false;
+};
+
+static TF_Result record_listener(TinyFrame* tf, TF_Msg* frame)
+{
+    RecordContext* ctx = static_cast<RecordContext*>(tf->userdata);
+    Clock::time_point now = Clock::now();
+    if (!ctx->started) {
+        ctx->start = now;
+        ctx->started = true;
+    }
+    uint64_t t_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now - ctx->start).count();
+    bool ok = false;
+    const char* name = ctx->decoder.decode(frame->type, frame->data, frame->len, &ok);
+    if (ctx->verbose) {
+        std::printf("%12.6f %-16s %5d %s\n", t_ns * 1e-9, name ? name : "unknown",
+            (int)frame->len, ok ? "ok" : "failed");
+    }
+    if (ctx->log) {
+        write_record(*ctx->log, t_ns, frame->type, frame->data, frame->len);
+    }
+    return TF_STAY;
+}
+
+static int cmd_record(const char* listen, const char* path, bool verbose)
+{
+    sockaddr_in addr;
+    if (!parse_endpoint(listen, &addr)) {
+        std::cerr << "bad endpoint: " << listen << "\n";
+        return 1;
+    }
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0) {
+        std::perror("socket");
+        return 1;
+    }
+    int rcvbuf = 8 << 20;
+    setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    timeval timeout = { 0, 10000 };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    if (bind(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        std::perror("bind");
+        close(sock);
+        return 1;
+    }
+
+    std::ofstream log;
+    if (path) {
+        log.open(path, std::ios::binary);
+        if (!log || !log.write(SYNAPSE_LOG_MAGIC, SYNAPSE_LOG_MAGIC_SIZE)) {
+            std::perror(path);
+            close(sock);
+            return 1;
+        }
+    }
+
+    RecordContext ctx;
+    ctx.log = path ? &log : nullptr;
+    ctx.verbose = verbose;
+    TinyFrame tf;
+    TF_InitStatic(&tf, TF_MASTER, nullptr);
+    tf.userdata = &ctx;
+    TF_AddGenericListener(&tf, record_listener);
+
+    enum { batch = 64,
+        max_length = 4096 };
+    std::vector<std::array<uint8_t, max_length>> bufs(batch);
+    std::array<mmsghdr, batch> msgs;
+    std::array<iovec, batch> iovs;
+
+    Clock::time_point last_stats = Clock::now();
+    uint64_t datagrams = 0;
+    while (!g_stop) {
+        for (int i = 0; i < batch; i++) {
+            iovs[i] = { bufs[i].data(), max_length };
+            std::memset(&msgs[i], 0, sizeof(msgs[i]));
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        // blocks for the first datagram, up to the receive timeout
+        int n = recvmmsg(sock, msgs.data(), batch, MSG_WAITFORONE, nullptr);
+        for (int i = 0; i < n; i++) {
+            TF_Accept(&tf, bufs[i].data(), msgs[i].msg_len);
+        }
+        datagrams += n > 0 ? n : 0;
+        TF_Tick(&tf);
+
+        Clock::time_point now = Clock::now();
+        double dt = std::chrono::duration<double>(now - last_stats).count();
+        if (dt >= 1.0) {
+            std::printf("datagrams %.0f/s\n", datagrams / dt);
+            ctx.decoder.print("rx", dt);
+            ctx.decoder.reset();
+            datagrams = 0;
+            last_stats = now;
+        }
+    }
+    close(sock);
+    // a failed write, e.g. a full disk, leaves a truncated log
+    if (path && !log.flush()) {
+        std::cerr << path << ": write failed, the log is incomplete\n";
+        return 1;
+    }
+    return 0;
+}
+
+/********************************************************************
+ * replay
+ ********************************************************************/
+struct ReplayContext {
+    int sock;
+    sockaddr_in dest;
+    std::vector<uint8_t> datagram;
+};
+
+static void replay_write(TinyFrame* tf, const uint8_t* buf, uint32_t len)
+{
+    ReplayContext* ctx = static_cast<ReplayContext*>(tf->userdata);
+    ctx->datagram.insert(ctx->datagram.end(), buf, buf + len);
+}
+
+static int cmd_replay(const char* path, const char* remote, bool fast, double speed, int loops)
+{
+    std::ifstream is;
+    if (!open_log(is, path)) {
+        return 1;
+    }
+    std::vector<Record> records;
+    Record r;
+    while (read_record(is, &r)) {
+        records.push_back(r);
+    }
+    if (records.empty()) {
+        std::cerr << path << ": no frames\n";
+        return 1;
+    }
+
+    ReplayContext ctx;
+    if (!parse_endpoint(remote, &ctx.dest)) {
+        std::cerr << "bad endpoint: " << remote << "\n";
+        return 1;
+    }
+    ctx.sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (ctx.sock < 0) {
+        std::perror("socket");
+        return 1;
+    }
+    TinyFrame tf;
+    TF_InitStatic(&tf, TF_MASTER, replay_write);
+    tf.userdata = &ctx;
+
+    Decoder decoder;
+    for (int loop = 0; (loops <= 0 || loop < loops) && !g_stop; loop++) {
+        Clock::time_point start = Clock::now();
+        for (const Record& rec : records) {
+            if (g_stop) {
+                break;
+            }
+            if (!fast) {
+                std::this_thread::sleep_until(start
+                    + std::chrono::nanoseconds(static_cast<uint64_t>(rec.t_ns / speed)));
+            }
+            TF_Msg msg;
+            TF_ClearMsg(&msg);
+            msg.type = rec.type;
+            msg.data = rec.data.data();
+            msg.len = rec.data.size();
+            ctx.datagram.clear();
+            TF_Send(&tf, &msg);
+            if (sendto(ctx.sock, ctx.datagram.data(), ctx.datagram.size(), 0,
+                    reinterpret_cast<sockaddr*>(&ctx.dest), sizeof(ctx.dest))
+                < 0) {
+                std::perror("sendto");
+            }
+            bool ok;
+            decoder.decode(rec.type, rec.data.data(), rec.data.size(), &ok);
+        }
+        double dt = std::chrono::duration<double>(Clock::now() - start).count();
+        std::printf("loop %d: %zu frames in %.3f s\n", loop, records.size(), dt);
+        decoder.print("tx", dt);
+        decoder.reset();
+    }
+    close(ctx.sock);
+    return 0;
+}
+
+/********************************************************************
+ * dump
+ ********************************************************************/
+static int cmd_dump(const char* path)
+{
+    std::ifstream is;
+    if (!open_log(is, path)) {
+        return 1;
+    }
+    Decoder decoder;
+    Record r;
+    uint64_t last_ns = 0;
+    while (read_record(is, &r)) {
+        bool ok = false;
+        const char* name = decoder.decode(r.type, r.data.data(), r.data.size(), &ok);
+        std::printf("%12.6f %-16s %5zu %s\n", r.t_ns * 1e-9, name ? name : "unknown",
+            r.data.size(), ok ? "ok" : "failed");
+        last_ns = r.t_ns;
+    }
+    decoder.print("log", last_ns > 0 ? last_ns * 1e-9 : 1.0);
+    return 0;
+}
+
+/********************************************************************
+ * load
+ ********************************************************************/
+// enum values from synapse_topic_list.h
+enum {
+    JOY_BUTTON_MANUAL = 0,
+    JOY_BUTTON_ARM = 7,
+    JOY_AXES_ROLL = 3,
+};
+
+struct LoadConfig {
+    double rate; // first level, frames/s
+    double max_rate;
+    double factor; // between levels
+    int burst; // frames sent back to back
+    double seconds; // per level
+    int step_ms; // joy roll flips sign this often
+    double limit_ms; // p99 latency above load_floor_ms a sustainable rate stays under
+    bool arm;
+};
+
+// joy reaches the manual node through a 10 Hz subscription and actuators
+// reach syn_eth_tx through a 50 Hz one, both drop publishes inside their
+// period, so a step can wait up to one period of each before it is seen
+static const double load_floor_ms = 1e3 / 10 + 1e3 / 50;
+
+struct LoadContext {
+    int sock;
+    sockaddr_in dest;
+    TinyFrame tx;
+    std::vector<uint8_t> datagram;
+    uint8_t payload[512];
+    // current step, written by the sender, read by the receiver, the id and
+    // roll sign packed as id << 1 | negative, under a seqlock with its time
+    std::atomic<uint32_t> step_seq { 0 };
+    std::atomic<uint32_t> step { 0 };
+    std::atomic<int64_t> step_ns { 0 };
+    std::atomic<bool> level_done { false };
+    uint64_t sent = 0;
+};
+
+static int64_t now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+static int step_id(uint32_t step)
+{
+    return static_cast<int>(step >> 1);
+}
+
+static int step_sign(uint32_t step)
+{
+    return (step & 1) ? -1 : 1;
+}
+
+// next id with the roll sign flipped, only called by the sender
+static void load_step(LoadContext* ctx)
+{
+    uint32_t step = ctx->step.load(std::memory_order_relaxed);
+    uint32_t seq = ctx->step_seq.load(std::memory_order_relaxed);
+    ctx->step_seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    ctx->step_ns.store(now_ns(), std::memory_order_relaxed);
+    ctx->step.store((((step >> 1) + 1) << 1) | ((step & 1) ^ 1), std::memory_order_relaxed);
+    ctx->step_seq.store(seq + 2, std::memory_order_release);
+}
+
+// the step and its time, from the same flip
+static uint32_t load_read_step(LoadContext* ctx, int64_t* ns)
+{
+    while (true) {
+        uint32_t seq = ctx->step_seq.load(std::memory_order_acquire);
+        if (seq & 1) {
+            continue;
+        }
+        uint32_t step = ctx->step.load(std::memory_order_relaxed);
+        *ns = ctx->step_ns.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (ctx->step_seq.load(std::memory_order_relaxed) == seq) {
+            return step;
+        }
+    }
+}
+
+static void load_write(TinyFrame* tf, const uint8_t* buf, uint32_t len)
+{
+    LoadContext* ctx = static_cast<LoadContext*>(tf->userdata);
+    ctx->datagram.insert(ctx->datagram.end(), buf, buf + len);
+}
+
+static void load_send(LoadContext* ctx, int type, const pb_msgdesc_t* fields, const void* msg)
+{
+    pb_ostream_t stream = pb_ostream_from_buffer(ctx->payload, sizeof(ctx->payload));
+    if (!pb_encode(&stream, fields, msg)) {
+        return;
+    }
+    TF_Msg frame;
+    TF_ClearMsg(&frame);
+    frame.type = type;
+    frame.data = ctx->payload;
+    frame.len = stream.bytes_written;
+    ctx->datagram.clear();
+    TF_Send(&ctx->tx, &frame);
+    if (sendto(ctx->sock, ctx->datagram.data(), ctx->datagram.size(), 0,
+            reinterpret_cast<sockaddr*>(&ctx->dest), sizeof(ctx->dest))
+        > 0) {
+        ctx->sent++;
+    }
+}
+
+// one level: bursts of frames at rate, every fourth a road_curve_angle,
+// and a joy roll sign flip every step_ms
+static void load_level(LoadContext* ctx, const LoadConfig& cfg, double rate)
+{
+    synapse_msgs_Joy joy;
+    std::memset(&joy, 0, sizeof(joy));
+    joy.axes_count = JOY_AXES_ROLL + 2;
+    if (cfg.arm) {
+        joy.buttons_count = JOY_BUTTON_ARM + 1;
+        joy.buttons[JOY_BUTTON_ARM] = 1;
+        joy.buttons[JOY_BUTTON_MANUAL] = 1;
+    }
+    synapse_msgs_RoadCurveAngle angle;
+    std::memset(&angle, 0, sizeof(angle));
+
+    auto interval = std::chrono::duration<double>(cfg.burst / rate);
+    Clock::time_point start = Clock::now();
+    Clock::time_point end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(cfg.seconds));
+    Clock::time_point next = start;
+    Clock::time_point next_step = start;
+    uint64_t n = 0;
+    while (Clock::now() < end && !g_stop) {
+        for (int i = 0; i < cfg.burst; i++, n++) {
+            if (Clock::now() >= next_step) {
+                load_step(ctx);
+                next_step += std::chrono::milliseconds(cfg.step_ms);
+            }
+            if (n % 4 == 3) {
+                load_send(ctx, SYNAPSE_ROAD_CURVE_ANGLE_TOPIC, synapse_msgs_RoadCurveAngle_fields, &angle);
+            } else {
+                joy.axes[JOY_AXES_ROLL] = 0.5f * step_sign(ctx->step.load(std::memory_order_relaxed));
+                load_send(ctx, SYNAPSE_JOY_TOPIC, synapse_msgs_Joy_fields, &joy);
+            }
+        }
+        next += std::chrono::duration_cast<Clock::duration>(interval);
+        std::this_thread::sleep_until(next);
+    }
+}
+
+struct LoadReceive {
+    int observed_id = 0;
+    std::vector<double> latency_ms;
+};
+
+static TF_Result load_listener(TinyFrame* tf, TF_Msg* frame)
+{
+    auto* pair = static_cast<std::pair<LoadContext*, LoadReceive*>*>(tf->userdata);
+    LoadContext* ctx = pair->first;
+    LoadReceive* rx = pair->second;
+    if (frame->type != SYNAPSE_ACTUATORS_TOPIC) {
+        return TF_STAY;
+    }
+    synapse_msgs_Actuators msg;
+    std::memset(&msg, 0, sizeof(msg));
+    pb_istream_t stream = pb_istream_from_buffer(frame->data, frame->len);
+    if (!pb_decode(&stream, synapse_msgs_Actuators_fields, &msg) || msg.position_count < 1) {
+        return TF_STAY;
+    }
+    int64_t ns = 0;
+    uint32_t step = load_read_step(ctx, &ns);
+    int sign = msg.position[0] > 0 ? 1 : msg.position[0] < 0 ? -1 : 0;
+    if (step_id(step) != rx->observed_id && sign == step_sign(step)) {
+        rx->observed_id = step_id(step);
+        rx->latency_ms.push_back((now_ns() - ns) * 1e-6);
+    }
+    return TF_STAY;
+}
+
+static int cmd_load(const char* listen, const char* remote, const LoadConfig& cfg)
+{
+    sockaddr_in addr;
+    LoadContext ctx;
+    if (!parse_endpoint(listen, &addr) || !parse_endpoint(remote, &ctx.dest)) {
+        std::cerr << "bad endpoint\n";
+        return 1;
+    }
+    ctx.sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (ctx.sock < 0) {
+        std::perror("socket");
+        return 1;
+    }
+    timeval timeout = { 0, 10000 };
+    setsockopt(ctx.sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    if (bind(ctx.sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        std::perror("bind");
+        close(ctx.sock);
+        return 1;
+    }
+    TF_InitStatic(&ctx.tx, TF_MASTER, load_write);
+    ctx.tx.userdata = &ctx;
+
+    LoadReceive rx;
+    std::pair<LoadContext*, LoadReceive*> pair(&ctx, &rx);
+    TinyFrame tf;
+    TF_InitStatic(&tf, TF_MASTER, nullptr);
+    tf.userdata = &pair;
+    TF_AddGenericListener(&tf, load_listener);
+
+    std::printf("latency includes up to %.0f ms of rate limit quantization, joy 10 Hz, actuators 50 Hz\n",
+        load_floor_ms);
+    std::printf("%10s %10s %6s %6s %8s %8s %8s\n", "rate", "sent/s", "steps", "seen", "p50 ms",
+        "p99 ms", "max ms");
+    double sustained = 0;
+    for (double rate = cfg.rate; rate <= cfg.max_rate && !g_stop; rate *= cfg.factor) {
+        rx.latency_ms.clear();
+        int first_id = step_id(ctx.step.load());
+        rx.observed_id = first_id;
+        ctx.sent = 0;
+        ctx.level_done = false;
+
+        std::thread sender([&]() {
+            load_level(&ctx, cfg, rate);
+            ctx.level_done = true;
+        });
+        uint8_t buf[4096];
+        // keep listening a little after the level for the last step
+        int64_t drain_until = 0;
+        while (!g_stop) {
+            ssize_t n = recv(ctx.sock, buf, sizeof(buf), 0);
+            if (n > 0) {
+                TF_Accept(&tf, buf, n);
+            }
+            TF_Tick(&tf);
+            if (ctx.level_done) {
+                if (drain_until == 0) {
+                    drain_until = now_ns() + static_cast<int64_t>((load_floor_ms + cfg.limit_ms) * 2e6);
+                } else if (now_ns() > drain_until) {
+                    break;
+                }
+            }
+        }
+        sender.join();
+
+        int steps = step_id(ctx.step.load()) - first_id;
+        std::vector<double>& l = rx.latency_ms;
+        std::sort(l.begin(), l.end());
+        auto pct = [&](double p) { return l.empty() ? 0.0 : l[std::min(l.size() - 1, static_cast<std::size_t>(p * l.size()))]; };
+        std::printf("%10.0f %10.0f %6d %6zu %8.2f %8.2f %8.2f\n", rate, ctx.sent / cfg.seconds, steps,
+            l.size(), pct(0.5), pct(0.99), l.empty() ? 0.0 : l.back());
+        std::fflush(stdout);
+
+        if (steps == 0 || static_cast<int>(l.size()) < steps || pct(0.99) > load_floor_ms + cfg.limit_ms) {
+            break;
+        }
+        sustained = rate;
+    }
+    std::printf("max sustainable rate: %.0f frames/s\n", sustained);
+    close(ctx.sock);
+    return 0;
+}
+
+static void usage(const char* name)
+{
+    std::cerr << "usage: " << name << " record [-l listen_ip[:port]] [-o log] [-v]\n"
+              << "       " << name << " replay -i log [-r remote_ip[:port]] [-f] [-s speed] [-n loops]\n"
+              << "       " << name << " dump -i log\n"
+              << "       " << name << " load [-l listen_ip[:port]] [-r remote_ip[:port]] [-R rate]"
+              << " [-M max_rate] [-F factor] [-b burst] [-t seconds] [-p step_ms] [-L limit_ms] [-a]\n";
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        usage(argv[0]);
+        return 1;
+    }
+    std::string cmd = argv[1];
+    const char* listen = "192.0.2.2:4242";
+    const char* remote = "192.0.2.1:4242";
+    const char* input = nullptr;
+    const char* output = nullptr;
+    bool verbose = false;
+    bool fast = false;
+    double speed = 1.0;
+    int loops = 1;
+    // steps longer than load_floor_ms, so every one can be seen
+    LoadConfig load = { 100, 20000, 2, 1, 3, 250, 50, false };
+
+    optind = 2;
+    int opt;
+    while ((opt = getopt(argc, argv, "l:o:vi:r:fs:n:R:M:F:b:t:p:L:ah")) != -1) {
+        switch (opt) {
+        case 'l':
+            listen = optarg;
+            break;
+        case 'o':
+            output = optarg;
+            break;
+        case 'v':
+            verbose = true;
+            break;
+        case 'i':
+            input = optarg;
+            break;
+        case 'r':
+            remote = optarg;
+            break;
+        case 'f':
+            fast = true;
+            break;
+        case 's':
+            speed = std::atof(optarg);
+            break;
+        case 'n':
+            loops = std::atoi(optarg);
+            break;
+        case 'R':
+            load.rate = std::atof(optarg);
+            break;
+        case 'M':
+            load.max_rate = std::atof(optarg);
+            break;
+        case 'F':
+            load.factor = std::atof(optarg);
+            break;
+        case 'b':
+            load.burst = std::max(1, std::atoi(optarg));
+            break;
+        case 't':
+            load.seconds = std::atof(optarg);
+            break;
+        case 'p':
+            load.step_ms = std::max(1, std::atoi(optarg));
+            break;
+        case 'L':
+            load.limit_ms = std::atof(optarg);
+            break;
+        case 'a':
+            load.arm = true;
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::signal(SIGINT, [](int) { g_stop = 1; });
+
+    if (cmd == "record") {
+        return cmd_record(listen, output, verbose);
+    } else if (cmd == "replay" && input && speed > 0) {
+        return cmd_replay(input, remote, fast, speed, loops);
+    } else if (cmd == "dump" && input) {
+        return cmd_dump(input);
+    } else if (cmd == "load" && load.rate > 0 && load.factor > 1) {
+        return cmd_load(listen, remote, load);
+    }
+    usage(argv[0]);
+    return 1;
+}
+
+// vi: ts=4 sw=4 et
@@ -1,95 +1,475 @@
 #include <boost/asio.hpp>
-#include <boost/asio/buffer.hpp>
 #include <boost/asio/ip/address.hpp>
-#include <boost/asio/placeholders.hpp>
 #include <boost/system/error_code.hpp>
-#include <ctime>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <getopt.h>
 #include <iostream>
-#include <memory>
+#include <sstream>
+#include <string>
+#include <sys/socket.h>
+#include <vector>
 
 using boost::asio::ip::udp;
 
-std::string make_daytime_string()
-{
-    using namespace std;
-    time_t now = time(0);
-    return ctime(&now);
-}
+// bidirectional relay between cerebri on native_sim and host tools
+//
+// datagrams from the remote endpoint (cerebri) fan out to every client,
+// datagrams from anyone else go to the remote endpoint. clients are given
+// on the command line, or else every other sender becomes one. datagrams
+// are received and sent in batches with recvmmsg/sendmmsg straight out of
+// a fixed pool of reference counted buffers, a fan out queues the same
+// buffer for every client. each destination has its own bounded queue, so
+// a client that falls behind only drops its own oldest datagrams. a client
+// given on the command line can have its own queue limit.
 
 class UDPServer {
 public:
+    enum { max_length = 4096,
+        batch = 64,
+        pool_size = 4 * batch,
+        max_learned = 8 };
+
+    // a client from the command line, a queue_limit of 0 takes the default
+    struct Client {
+        udp::endpoint endpoint;
+        std::size_t queue_limit = 0;
+    };
+
     UDPServer(boost::asio::io_context& io_context,
-        const char* local_ip, const char* local_port,
-        const char* remote_ip, const char* remote_port)
+        const udp::endpoint& local, const udp::endpoint& remote,
+        const std::vector<Client>& clients, std::size_t queue_limit, int log_rate)
+        : socket_(io_context, local)
+        , timer_(io_context)
+        , queue_limit_(queue_limit)
+        , learn_clients_(clients.empty())
+        , log_rate_(log_rate)
     {
-        udp::resolver resolver(io_context);
-        local_endpoint_ = std::make_shared<udp::endpoint>(*resolver.resolve(
-            udp::resolver::query(udp::v4(), local_ip, local_port)));
-        std::cout << "local endpoint: "
-                  << local_endpoint_->address().to_string()
-                  << ": " << local_endpoint_->port()
-                  << std::endl;
-        remote_endpoint_ = std::make_shared<udp::endpoint>(*resolver.resolve(
-            udp::resolver::query(udp::v4(), remote_ip, remote_port)));
-        std::cout << "remote endpoint: "
-                  << remote_endpoint_->address().to_string()
-                  << ": " << remote_endpoint_->port()
-                  << std::endl;
-        socket_ = std::make_shared<udp::socket>(io_context, *local_endpoint_);
-        do_receive();
+        remote_.endpoint = remote;
+        remote_.queue_limit = queue_limit_;
+        for (const Client& client : clients) {
+            clients_.emplace_back();
+            clients_.back().endpoint = client.endpoint;
+            clients_.back().queue_limit = client.queue_limit > 0 ? client.queue_limit : queue_limit_;
+        }
+        socket_.non_blocking(true);
+        for (std::size_t i = 0; i < pool_size; i++) {
+            free_.push_back(i);
+        }
+        std::cout << "local endpoint: " << local << "\n"
+                  << "remote endpoint: " << remote_.endpoint << "\n";
+        for (const Peer& client : clients_) {
+            std::cout << "client endpoint: " << client.endpoint
+                      << " queue limit: " << client.queue_limit << "\n";
+        }
+        start_receive();
+        start_stats();
     }
 
 private:
-    void handle_receive(boost::system::error_code ec, std::size_t bytes_received)
+    struct Stats {
+        uint64_t rx_packets = 0;
+        uint64_t rx_bytes = 0;
+        uint64_t tx_packets = 0;
+        uint64_t tx_bytes = 0;
+        uint64_t truncated = 0;
+        uint64_t send_errors = 0;
+        uint64_t no_client = 0;
+        uint64_t logged = 0;
+        uint64_t suppressed = 0;
+    };
+
+    struct Packet {
+        std::size_t buf;
+        std::size_t len;
+    };
+
+    struct Peer {
+        udp::endpoint endpoint;
+        std::deque<Packet> queue;
+        std::size_t queue_limit = 1;
+        uint64_t sent = 0;
+        uint64_t dropped = 0;
+    };
+
+    void start_receive()
+    {
+        if (receiving_ || free_.empty()) {
+            return;
+        }
+        receiving_ = true;
+        socket_.async_wait(udp::socket::wait_read,
+            [this](boost::system::error_code ec) {
+                receiving_ = false;
+                if (ec) {
+                    std::cerr << "receive wait failed: " << ec.message() << "\n";
+                    return;
+                }
+                receive();
+                start_receive();
+            });
+    }
+
+    void start_send()
+    {
+        if (sending_) {
+            return;
+        }
+        sending_ = true;
+        socket_.async_wait(udp::socket::wait_write,
+            [this](boost::system::error_code ec) {
+                sending_ = false;
+                if (ec) {
+                    std::cerr << "send wait failed: " << ec.message() << "\n";
+                    return;
+                }
+                send();
+                start_receive();
+            });
+    }
+
+    // drain the socket into free buffers, a batch per system call
+    void receive()
     {
-        std::cout << local_endpoint_->address().to_string()
-                  << ":" << local_endpoint_->port() << ": received: " << bytes_received << std::endl;
-        if (!ec && bytes_received > 0) {
-            do_send(bytes_received);
+        std::array<mmsghdr, batch> msgs;
+        std::array<iovec, batch> iovs;
+        std::array<sockaddr_storage, batch> srcs;
+        std::array<std::size_t, batch> bufs;
+
+        while (!free_.empty()) {
+            std::size_t n = std::min<std::size_t>(free_.size(), batch);
+            for (std::size_t i = 0; i < n; i++) {
+                bufs[i] = free_[free_.size() - 1 - i];
+                iovs[i] = { pool_[bufs[i]].data(), max_length };
+                std::memset(&msgs[i], 0, sizeof(msgs[i]));
+                msgs[i].msg_hdr.msg_iov = &iovs[i];
+                msgs[i].msg_hdr.msg_iovlen = 1;
+                msgs[i].msg_hdr.msg_name = &srcs[i];
+                msgs[i].msg_hdr.msg_namelen = sizeof(srcs[i]);
+            }
+
+            int ret = recvmmsg(socket_.native_handle(), msgs.data(), n, MSG_DONTWAIT, nullptr);
+            if (ret <= 0) {
+                if (ret < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                    std::perror("recvmmsg");
+                }
+                return;
+            }
+
+            // take all received buffers before routing may return some
+            free_.resize(free_.size() - ret);
+            for (int i = 0; i < ret; i++) {
+                udp::endpoint src;
+                std::memcpy(src.data(), &srcs[i], msgs[i].msg_hdr.msg_namelen);
+                route(bufs[i], msgs[i].msg_len, msgs[i].msg_hdr.msg_flags, src);
+            }
+            // forward each batch before the next, so a burst only fills
+            // the queues of peers the socket can not keep up with
+            send();
+        }
+    }
+
+    void route(std::size_t buf, std::size_t len, int flags, const udp::endpoint& src)
+    {
+        stats_.rx_packets++;
+        stats_.rx_bytes += len;
+        log(src, len);
+
+        if (flags & MSG_TRUNC) {
+            stats_.truncated++;
+            free_.push_back(buf);
+            return;
+        }
+
+        if (src == remote_.endpoint) {
+            for (Peer& client : clients_) {
+                enqueue(client, buf, len);
+            }
+            if (clients_.empty()) {
+                stats_.no_client++;
+            }
         } else {
-            do_receive();
+            learn(src);
+            enqueue(remote_, buf, len);
         }
-    };
+        if (refs_[buf] == 0) {
+            free_.push_back(buf);
+        }
+    }
 
-    void handle_send(boost::system::error_code ec, std::size_t bytes_sent)
+    void learn(const udp::endpoint& src)
     {
-        std::cout << remote_endpoint_->address().to_string()
-                  << ":" << remote_endpoint_->port() << ": sent: " << bytes_sent << std::endl;
-        (void)ec;
-        (void)bytes_sent;
-        do_receive();
-    };
+        if (!learn_clients_) {
+            return;
+        }
+        for (const Peer& client : clients_) {
+            if (client.endpoint == src) {
+                return;
+            }
+        }
+        if (clients_.size() == max_learned) {
+            // said once, the sender is not told about it
+            if (!learn_full_logged_) {
+                learn_full_logged_ = true;
+                std::cerr << "client " << src << " ignored, already " << max_learned
+                          << " clients, give them with -c\n";
+            }
+            return;
+        }
+        clients_.emplace_back();
+        clients_.back().endpoint = src;
+        clients_.back().queue_limit = queue_limit_;
+        std::cout << "client endpoint: " << src << "\n";
+    }
 
-    void do_receive()
+    // queue a reference to buf, dropping the peer's oldest when it is full
+    void enqueue(Peer& peer, std::size_t buf, std::size_t len)
     {
-        socket_->async_receive_from(
-            boost::asio::buffer(data_, max_length), *local_endpoint_,
-            std::bind(&UDPServer::handle_receive, this, std::placeholders::_1, std::placeholders::_2));
+        if (peer.queue.size() >= peer.queue_limit) {
+            release(peer.queue.front().buf);
+            peer.queue.pop_front();
+            peer.dropped++;
+        }
+        peer.queue.push_back({ buf, len });
+        refs_[buf]++;
     }
 
-    void do_send(size_t bytes_received)
+    void release(std::size_t buf)
     {
-        socket_->async_send_to(
-            boost::asio::buffer(data_, bytes_received), *remote_endpoint_,
-            std::bind(&UDPServer::handle_send, this, std::placeholders::_1, std::placeholders::_2));
+        if (--refs_[buf] == 0) {
+            free_.push_back(buf);
+        }
     }
 
-    std::shared_ptr<udp::socket> socket_;
-    std::shared_ptr<udp::endpoint> local_endpoint_;
-    std::shared_ptr<udp::endpoint> remote_endpoint_;
-    enum { max_length = 4096 };
-    char data_[max_length];
+    // send queued datagrams, a batch per system call taken round robin
+    // from the peers, until the socket would block
+    void send()
+    {
+        std::array<mmsghdr, batch> msgs;
+        std::array<iovec, batch> iovs;
+        std::array<Peer*, batch> peers;
+        std::vector<Peer*> all;
+        all.push_back(&remote_);
+        for (Peer& client : clients_) {
+            all.push_back(&client);
+        }
+
+        while (true) {
+            std::size_t n = 0;
+            for (std::size_t depth = 0; n < batch; depth++) {
+                bool more = false;
+                for (Peer* peer : all) {
+                    if (depth >= peer->queue.size() || n == batch) {
+                        continue;
+                    }
+                    const Packet& p = peer->queue[depth];
+                    iovs[n] = { pool_[p.buf].data(), p.len };
+                    std::memset(&msgs[n], 0, sizeof(msgs[n]));
+                    msgs[n].msg_hdr.msg_iov = &iovs[n];
+                    msgs[n].msg_hdr.msg_iovlen = 1;
+                    msgs[n].msg_hdr.msg_name = peer->endpoint.data();
+                    msgs[n].msg_hdr.msg_namelen = peer->endpoint.size();
+                    peers[n++] = peer;
+                    more = true;
+                }
+                if (!more) {
+                    break;
+                }
+            }
+            if (n == 0) {
+                return;
+            }
+
+            int ret = sendmmsg(socket_.native_handle(), msgs.data(), n, MSG_DONTWAIT);
+            if (ret < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    start_send();
+                    return;
+                }
+                // the first datagram failed, drop it and go on
+                stats_.send_errors++;
+                ret = 1;
+            } else {
+                for (int i = 0; i < ret; i++) {
+                    stats_.tx_packets++;
+                    stats_.tx_bytes += msgs[i].msg_len;
+                    peers[i]->sent++;
+                }
+            }
+
+            // what was sent is a prefix of each peer's queue
+            for (int i = 0; i < ret; i++) {
+                release(peers[i]->queue.front().buf);
+                peers[i]->queue.pop_front();
+            }
+        }
+    }
+
+    // per packet logging, at most log_rate_ lines per second
+    void log(const udp::endpoint& src, std::size_t len)
+    {
+        if (log_rate_ <= 0) {
+            return;
+        }
+        if (stats_.logged >= static_cast<uint64_t>(log_rate_)) {
+            stats_.suppressed++;
+            return;
+        }
+        stats_.logged++;
+        std::cout << src << ": received: " << len << "\n";
+    }
+
+    void start_stats()
+    {
+        timer_.expires_after(std::chrono::seconds(1));
+        timer_.async_wait([this](boost::system::error_code ec) {
+            if (ec) {
+                return;
+            }
+            print_stats();
+            start_stats();
+        });
+    }
+
+    void print_stats()
+    {
+        total_.truncated += stats_.truncated;
+        total_.send_errors += stats_.send_errors;
+        total_.no_client += stats_.no_client;
+
+        std::printf("rx: %lu pkt/s %lu B/s, tx: %lu pkt/s %lu B/s, "
+                    "drops: truncated %lu send %lu no_client %lu",
+            (unsigned long)stats_.rx_packets, (unsigned long)stats_.rx_bytes,
+            (unsigned long)stats_.tx_packets, (unsigned long)stats_.tx_bytes,
+            (unsigned long)total_.truncated, (unsigned long)total_.send_errors,
+            (unsigned long)total_.no_client);
+        if (stats_.suppressed > 0) {
+            std::printf(", log suppressed %lu", (unsigned long)stats_.suppressed);
+        }
+        std::printf("\n");
+        print_peer("remote", remote_);
+        for (const Peer& client : clients_) {
+            print_peer("client", client);
+        }
+        std::fflush(stdout);
+        stats_ = Stats();
+    }
+
+    void print_peer(const char* role, const Peer& peer)
+    {
+        std::ostringstream ep;
+        ep << peer.endpoint;
+        std::printf("  %s %s: sent %lu, queued %lu, dropped %lu\n", role, ep.str().c_str(),
+            (unsigned long)peer.sent, (unsigned long)peer.queue.size(),
+            (unsigned long)peer.dropped);
+    }
+
+    udp::socket socket_;
+    boost::asio::steady_timer timer_;
+    Peer remote_;
+    std::deque<Peer> clients_; // stable addresses, peers are never removed
+    std::size_t queue_limit_; // remote and learned clients
+    bool learn_clients_;
+    bool learn_full_logged_ = false;
+    int log_rate_;
+
+    std::vector<std::array<char, max_length>> pool_ { pool_size };
+    std::vector<int> refs_ = std::vector<int>(pool_size, 0);
+    std::vector<std::size_t> free_;
+    bool receiving_ = false;
+    bool sending_ = false;
+
+    Stats stats_; // this second
+    Stats total_; // drops since start
 };
 
-int main()
+static udp::endpoint resolve(boost::asio::io_context& io_context, const char* ip, const char* port)
 {
+    udp::resolver resolver(io_context);
+    return *resolver.resolve(udp::v4(), ip, port).begin();
+}
+
+// ip[:port][/queue_limit], port defaults to 4242, the limit to -Q
+static UDPServer::Client resolve_client(boost::asio::io_context& io_context, const std::string& arg)
+{
+    UDPServer::Client client;
+    std::string peer = arg;
+    std::size_t slash = peer.find('/');
+    if (slash != std::string::npos) {
+        client.queue_limit = std::max(1, std::atoi(peer.c_str() + slash + 1));
+        peer.resize(slash);
+    }
+    std::size_t colon = peer.rfind(':');
+    if (colon == std::string::npos) {
+        client.endpoint = resolve(io_context, peer.c_str(), "4242");
+    } else {
+        client.endpoint = resolve(io_context, peer.substr(0, colon).c_str(),
+            peer.substr(colon + 1).c_str());
+    }
+    return client;
+}
+
+static void usage(const char* name)
+{
+    std::cerr << "usage: " << name << " [-l local_ip] [-p local_port] [-r remote_ip]"
+              << " [-q remote_port] [-c client_ip[:port][/queue_limit]]... [-Q queue_limit]"
+              << " [-v lines_per_sec]\n";
+}
+
+int main(int argc, char** argv)
+{
+    const char* local_ip = "192.0.2.2";
+    const char* local_port = "4242";
+    const char* remote_ip = "192.0.2.1";
+    const char* remote_port = "4242";
+    std::vector<std::string> client_args;
+    std::size_t queue_limit = 64;
+    int log_rate = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "l:p:r:q:c:Q:v:h")) != -1) {
+        switch (opt) {
+        case 'l':
+            local_ip = optarg;
+            break;
+        case 'p':
+            local_port = optarg;
+            break;
+        case 'r':
+            remote_ip = optarg;
+            break;
+        case 'q':
+            remote_port = optarg;
+            break;
+        case 'c':
+            client_args.push_back(optarg);
+            break;
+        case 'Q':
+            queue_limit = std::max(1, std::atoi(optarg));
+            break;
+        case 'v':
+            log_rate = std::atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
     try {
         boost::asio::io_context io_context;
-        const char* local_port = "4242";
-        const char* local_ip = "192.0.2.2";
-        const char* remote_port = "4242";
-        const char* remote_ip = "192.0.2.1";
-        UDPServer server(io_context, local_ip, local_port, remote_ip, remote_port);
+        udp::endpoint local = resolve(io_context, local_ip, local_port);
+        udp::endpoint remote = resolve(io_context, remote_ip, remote_port);
+        std::vector<UDPServer::Client> clients;
+        for (const std::string& arg : client_args) {
+            clients.push_back(resolve_client(io_context, arg));
+        }
+        UDPServer server(io_context, local, remote, clients, queue_limit, log_rate);
         std::cout << "running" << std::endl;
         io_context.run();
         std::cout << "finished" << std::endl;
@@ -0,0 +1,27 @@
+/*
+ * Copyright (c) 2023 CogniPilot Foundation
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+
+#include <zros/zros_node.h>
+
+#define BENCH_ITERATIONS 10000
+
+extern struct zros_node g_bench_node;
+
+void bench_report(const char* name, int param, int iterations, uint64_t ns);
+void bench_report_dist(const char* name, int param, int n, uint64_t min_ns, uint64_t mean_ns,
+    uint64_t max_ns);
+void bench_report_error(const char* name, int param, int rc);
+
+void bench_access(void);
+void bench_fanout(void);
+void bench_wakeup(void);
+void bench_throughput(void);
+
+#endif // BENCH_H
+// vi: ts=4 sw=4 et
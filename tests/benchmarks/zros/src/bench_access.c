@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2023 CogniPilot Foundation
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdio.h>
+
+#include <zephyr/kernel.h>
+
+#include <zros/private/zros_pub_struct.h>
+#include <zros/private/zros_sub_struct.h>
+#include <zros/private/zros_topic_struct.h>
+#include <zros/zros_pub.h>
+#include <zros/zros_sub.h>
+#include <zros/zros_topic.h>
+
+#include "bench.h"
+#include "bench_clock.h"
+
+struct bench_msg {
+    uint8_t data[64];
+};
+
+ZROS_TOPIC_DEFINE(bench_lock, struct bench_msg, ZROS_TOPIC_MODE_LOCK);
+ZROS_TOPIC_DEFINE(bench_seqlock, struct bench_msg, ZROS_TOPIC_MODE_SEQLOCK);
+ZROS_TOPIC_DEFINE(bench_loan, struct bench_msg, ZROS_TOPIC_MODE_LOAN);
+
+static struct zros_pub g_pub[3];
+static struct zros_sub g_sub[3];
+static struct bench_msg g_pub_msg;
+static struct bench_msg g_sub_msg;
+
+// publish and read latency of one 64 byte message, for each topic mode,
+// with one subscriber attached
+static void bench_access_topic(const char* mode, struct zros_topic* topic,
+    struct zros_pub* pub, struct zros_sub* sub)
+{
+    char name[40];
+    zros_pub_init(pub, &g_bench_node, topic, &g_pub_msg);
+    zros_sub_init(sub, &g_bench_node, topic, &g_sub_msg, 1e9);
+
+    uint64_t start = bench_clock_ns();
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        g_pub_msg.data[0] = i;
+        zros_pub_update(pub);
+    }
+    snprintf(name, sizeof(name), "publish_%s", mode);
+    bench_report(name, sizeof(struct bench_msg), BENCH_ITERATIONS, bench_clock_ns() - start);
+
+    start = bench_clock_ns();
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        zros_sub_update(sub);
+    }
+    snprintf(name, sizeof(name), "read_%s", mode);
+    bench_report(name, sizeof(struct bench_msg), BENCH_ITERATIONS, bench_clock_ns() - start);
+
+    if (topic->_mode == ZROS_TOPIC_MODE_LOAN) {
+        int rc = 0;
+        start = bench_clock_ns();
+        for (int i = 0; i < BENCH_ITERATIONS && rc == 0; i++) {
+            struct bench_msg* msg = NULL;
+            rc = zros_pub_loan(pub, (void**)&msg);
+            if (rc == 0) {
+                msg->data[0] = i;
+                zros_pub_commit(pub);
+            }
+        }
+        if (rc < 0) {
+            bench_report_error("loan_commit", sizeof(struct bench_msg), rc);
+        } else {
+            bench_report("loan_commit", sizeof(struct bench_msg), BENCH_ITERATIONS,
+                bench_clock_ns() - start);
+        }
+
+        rc = 0;
+        start = bench_clock_ns();
+        for (int i = 0; i < BENCH_ITERATIONS && rc == 0; i++) {
+            const struct bench_msg* msg = NULL;
+            rc = zros_sub_borrow(sub, (const void**)&msg);
+            if (rc == 0) {
+                zros_sub_release(sub);
+            }
+        }
+        if (rc < 0) {
+            bench_report_error("borrow_release", sizeof(struct bench_msg), rc);
+        } else {
+            bench_report("borrow_release", sizeof(struct bench_msg), BENCH_ITERATIONS,
+                bench_clock_ns() - start);
+        }
+    }
+
+    zros_sub_fini(sub);
+    zros_pub_fini(pub);
+}
+
+void bench_access(void)
+{
+    bench_access_topic("lock", &topic_bench_lock, &g_pub[0], &g_sub[0]);
+    bench_access_topic("seqlock", &topic_bench_seqlock, &g_pub[1], &g_sub[1]);
+    bench_access_topic("loan", &topic_bench_loan, &g_pub[2], &g_sub[2]);
+}
+
+// vi: ts=4 sw=4 et
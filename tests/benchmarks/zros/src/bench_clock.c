@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2023 CogniPilot Foundation
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "bench_clock.h"
+
+#if defined(CONFIG_ARCH_POSIX)
+
+#include "bench_clock_bottom.h"
+
+void bench_clock_init(void)
+{
+}
+
+uint64_t bench_clock_ns(void)
+{
+    return bench_clock_bottom_ns();
+}
+
+#else
+
+#include <zephyr/timing/timing.h>
+
+static timing_t g_start;
+
+void bench_clock_init(void)
+{
+    timing_init();
+    timing_start();
+    g_start = timing_counter_get();
+}
+
+uint64_t bench_clock_ns(void)
+{
+    timing_t now = timing_counter_get();
+    return timing_cycles_to_ns(timing_cycles_get(&g_start, &now));
+}
+
+#endif
+
+// vi: ts=4 sw=4 et
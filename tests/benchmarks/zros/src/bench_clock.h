@@ -0,0 +1,14 @@
+/*
+ * Copyright (c) 2023 CogniPilot Foundation
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef BENCH_CLOCK_H
+#define BENCH_CLOCK_H
+
+#include <stdint.h>
+
+void bench_clock_init(void);
+uint64_t bench_clock_ns(void);
+
+#endif // BENCH_CLOCK_H
+// vi: ts=4 sw=4 et
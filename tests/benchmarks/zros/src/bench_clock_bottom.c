@@ -0,0 +1,16 @@
+/*
+ * Copyright (c) 2023 CogniPilot Foundation
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <time.h>
+
+#include "bench_clock_bottom.h"
+
+uint64_t bench_clock_bottom_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// vi: ts=4 sw=4 et
@@ -0,0 +1,14 @@
+/*
+ * Copyright (c) 2023 CogniPilot Foundation
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef BENCH_CLOCK_BOTTOM_H
+#define BENCH_CLOCK_BOTTOM_H
+
+#include <stdint.h>
+
+// host monotonic clock, built into the native simulator runner
+uint64_t bench_clock_bottom_ns(void);
+
+#endif // BENCH_CLOCK_BOTTOM_H
+// vi: ts=4 sw=4 et
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2023 CogniPilot Foundation
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <zephyr/kernel.h>
+
+#include <zros/private/zros_sub_struct.h>
+#include <zros/private/zros_topic_struct.h>
+#include <zros/zros_sub.h>
+#include <zros/zros_topic.h>
+
+#include "bench.h"
+#include "bench_clock.h"
+
+#define BENCH_MAX_SUBS 32
+
+struct bench_msg {
+    uint8_t data[64];
+};
+
+ZROS_TOPIC_DEFINE(bench_fanout, struct bench_msg, ZROS_TOPIC_MODE_LOCK);
+
+static struct zros_sub g_subs[BENCH_MAX_SUBS];
+static struct bench_msg g_sub_msg[BENCH_MAX_SUBS];
+static struct bench_msg g_msg;
+
+// publish cost with 1..32 subscribers, the limit is above the tick rate so
+// every publish signals every subscriber
+void bench_fanout(void)
+{
+    int n_subs = 0;
+    uint64_t ns_first = 0;
+    uint64_t ns_last = 0;
+    for (int n = 1; n <= BENCH_MAX_SUBS; n *= 2) {
+        for (; n_subs < n; n_subs++) {
+            zros_sub_init(&g_subs[n_subs], &g_bench_node, &topic_bench_fanout,
+                &g_sub_msg[n_subs], 1e9);
+        }
+        uint64_t start = bench_clock_ns();
+        for (int i = 0; i < BENCH_ITERATIONS; i++) {
+            g_msg.data[0] = i;
+            zros_topic_publish(&topic_bench_fanout, &g_msg);
+        }
+        uint64_t ns = bench_clock_ns() - start;
+        bench_report("fanout_publish", n, BENCH_ITERATIONS, ns);
+        if (n == 1) {
+            ns_first = ns;
+        }
+        ns_last = ns;
+    }
+    for (int i = 0; i < n_subs; i++) {
+        zros_sub_fini(&g_subs[i]);
+    }
+
+    // marginal cost of one more subscriber on a publish
+    bench_report("fanout_per_sub", BENCH_MAX_SUBS, BENCH_ITERATIONS * (BENCH_MAX_SUBS - 1),
+        ns_last > ns_first ? ns_last - ns_first : 0);
+}
+
+// vi: ts=4 sw=4 et
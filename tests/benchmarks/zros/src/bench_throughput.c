@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2023 CogniPilot Foundation
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdio.h>
+
+#include <zephyr/kernel.h>
+
+#include <zros/private/zros_sub_struct.h>
+#include <zros/private/zros_topic_struct.h>
+#include <zros/zros_sub.h>
+#include <zros/zros_topic.h>
+
+#include "bench.h"
+#include "bench_clock.h"
+
+#define BENCH_MSG_DEFINE(SIZE)                                           \
+    struct bench_msg_##SIZE {                                            \
+        uint8_t data[SIZE];                                              \
+    };                                                                   \
+    ZROS_TOPIC_DEFINE(bench_##SIZE, struct bench_msg_##SIZE,             \
+        ZROS_TOPIC_MODE_SEQLOCK);                                        \
+    static struct bench_msg_##SIZE g_pub_msg_##SIZE;                     \
+    static struct bench_msg_##SIZE g_sub_msg_##SIZE;                     \
+    static struct zros_sub g_sub_##SIZE;
+
+#define BENCH_MSG_RUN(SIZE)                                              \
+    bench_throughput_size(SIZE, &topic_bench_##SIZE, &g_sub_##SIZE,      \
+        &g_pub_msg_##SIZE, &g_sub_msg_##SIZE)
+
+BENCH_MSG_DEFINE(16)
+BENCH_MSG_DEFINE(64)
+BENCH_MSG_DEFINE(256)
+BENCH_MSG_DEFINE(1024)
+BENCH_MSG_DEFINE(4096)
+
+// publish then read back one message of each size, the report gives ns per
+// round trip and bytes moved per second through the topic
+static void bench_throughput_size(int size, struct zros_topic* topic, struct zros_sub* sub,
+    void* pub_msg, void* sub_msg)
+{
+    zros_sub_init(sub, &g_bench_node, topic, sub_msg, 1e9);
+    uint64_t start = bench_clock_ns();
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        ((uint8_t*)pub_msg)[0] = i;
+        zros_topic_publish(topic, pub_msg);
+        zros_sub_update(sub);
+    }
+    uint64_t ns = bench_clock_ns() - start;
+    zros_sub_fini(sub);
+
+    bench_report("throughput", size, BENCH_ITERATIONS, ns);
+    uint64_t bytes = (uint64_t)size * BENCH_ITERATIONS;
+    printf("zros_bench name=throughput_rate param=%d bytes_per_sec=%llu\n", size,
+        (unsigned long long)(ns > 0 ? bytes * 1000000000ULL / ns : 0));
+}
+
+void bench_throughput(void)
+{
+    BENCH_MSG_RUN(16);
+    BENCH_MSG_RUN(64);
+    BENCH_MSG_RUN(256);
+    BENCH_MSG_RUN(1024);
+    BENCH_MSG_RUN(4096);
+}
+
+// vi: ts=4 sw=4 et
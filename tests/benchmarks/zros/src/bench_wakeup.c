@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2023 CogniPilot Foundation
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <zephyr/kernel.h>
+
+#include <zros/private/zros_sub_struct.h>
+#include <zros/private/zros_topic_struct.h>
+#include <zros/zros_sub.h>
+#include <zros/zros_topic.h>
+
+#include "bench.h"
+#include "bench_clock.h"
+
+#define BENCH_WAKEUP_ROUNDS 1000
+#define BENCH_WAKEUP_STACK_SIZE 2048
+
+struct bench_msg {
+    uint8_t data[64];
+};
+
+ZROS_TOPIC_DEFINE(bench_wakeup, struct bench_msg, ZROS_TOPIC_MODE_SEQLOCK);
+
+static K_THREAD_STACK_DEFINE(g_waiter_stack, BENCH_WAKEUP_STACK_SIZE);
+static struct k_thread g_waiter_thread;
+static K_SEM_DEFINE(g_waiter_ready, 0, 1);
+static K_SEM_DEFINE(g_woken, 0, 1);
+
+static struct zros_sub g_sub;
+static struct bench_msg g_sub_msg;
+static struct bench_msg g_msg;
+static uint64_t g_publish_ns;
+static uint64_t g_wakeup_ns;
+
+static void bench_waiter(void* p0, void* p1, void* p2)
+{
+    zros_sub_init(&g_sub, &g_bench_node, &topic_bench_wakeup, &g_sub_msg, 1e9);
+    struct k_poll_event events[] = {
+        *zros_sub_get_event(&g_sub),
+    };
+    k_sem_give(&g_waiter_ready);
+    for (int i = 0; i < BENCH_WAKEUP_ROUNDS; i++) {
+        k_poll(events, ARRAY_SIZE(events), K_FOREVER);
+        g_wakeup_ns = bench_clock_ns() - g_publish_ns;
+        if (zros_sub_update_available(&g_sub)) {
+            zros_sub_update(&g_sub);
+        }
+        events[0].state = K_POLL_STATE_NOT_READY;
+        k_sem_give(&g_woken);
+    }
+    zros_sub_fini(&g_sub);
+}
+
+// time from the start of a publish until a higher priority subscriber
+// thread returns from k_poll
+void bench_wakeup(void)
+{
+    k_thread_create(&g_waiter_thread, g_waiter_stack, K_THREAD_STACK_SIZEOF(g_waiter_stack),
+        bench_waiter, NULL, NULL, NULL, k_thread_priority_get(k_current_get()) - 1, 0,
+        K_NO_WAIT);
+    k_sem_take(&g_waiter_ready, K_FOREVER);
+
+    uint64_t min_ns = UINT64_MAX;
+    uint64_t max_ns = 0;
+    uint64_t sum_ns = 0;
+    for (int i = 0; i < BENCH_WAKEUP_ROUNDS; i++) {
+        g_msg.data[0] = i;
+        g_publish_ns = bench_clock_ns();
+        zros_topic_publish(&topic_bench_wakeup, &g_msg);
+        k_sem_take(&g_woken, K_FOREVER);
+        min_ns = MIN(min_ns, g_wakeup_ns);
+        max_ns = MAX(max_ns, g_wakeup_ns);
+        sum_ns += g_wakeup_ns;
+    }
+    k_thread_join(&g_waiter_thread, K_FOREVER);
+    bench_report_dist("wakeup", sizeof(struct bench_msg), BENCH_WAKEUP_ROUNDS, min_ns,
+        sum_ns / BENCH_WAKEUP_ROUNDS, max_ns);
+}
+
+// vi: ts=4 sw=4 et
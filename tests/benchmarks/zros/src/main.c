@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2023 CogniPilot Foundation
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdio.h>
+
+#include <zephyr/kernel.h>
+
+#include <zros/private/zros_node_struct.h>
+
+#include "bench.h"
+#include "bench_clock.h"
+
+struct zros_node g_bench_node;
+
+// one line per result, space separated key=value pairs, times in ns
+void bench_report(const char* name, int param, int iterations, uint64_t ns)
+{
+    printf("zros_bench name=%s param=%d iterations=%d ns_per_op=%llu\n", name, param,
+        iterations, (unsigned long long)(ns / iterations));
+}
+
+void bench_report_dist(const char* name, int param, int n, uint64_t min_ns, uint64_t mean_ns,
+    uint64_t max_ns)
+{
+    printf("zros_bench name=%s param=%d iterations=%d min_ns=%llu mean_ns=%llu max_ns=%llu\n",
+        name, param, n, (unsigned long long)min_ns, (unsigned long long)mean_ns,
+        (unsigned long long)max_ns);
+}
+
+// a case that failed, in place of its result
+void bench_report_error(const char* name, int param, int rc)
+{
+    printf("zros_bench name=%s param=%d error=%d\n", name, param, rc);
+}
+
+int main(void)
+{
+    bench_clock_init();
+    zros_node_init(&g_bench_node, "bench");
+    printf("zros_bench begin board=%s\n", CONFIG_BOARD);
+    bench_access();
+    bench_fanout();
+    bench_wakeup();
+    bench_throughput();
+    printf("zros_bench end\n");
+    return 0;
+}
+
+// vi: ts=4 sw=4 et